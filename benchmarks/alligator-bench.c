@@ -0,0 +1,101 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <adder.h>
+#include <alligator/alligator.h>
+#include "benchmark.h"
+
+#if defined(ALLIGATOR_BACKEND_SLAB)
+#define BACKEND "slab"
+#else
+#define BACKEND "libc"
+#endif
+
+#define ROUNDS  5
+
+typedef void (*Benchmark_Fn)(size_t iterations);
+
+static void libcCycle(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        void *memory = malloc(32);
+        Benchmark_use(memory);
+        free(memory);
+    }
+}
+
+static void alligatorCycle(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        void *memory = Option_unwrap(Alligator_malloc(32));
+        Benchmark_use(memory);
+        Alligator_free(memory);
+    }
+}
+
+static void closureCycle(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        struct AdderClosure *adder = AdderClosure_new((int) i);
+        struct AdderResult *result = Result_unwrap(AdderClosure_call(adder, 1));
+        Benchmark_use(AdderResult_get(result));
+        AdderResult_delete(result);
+        AdderClosure_delete(adder);
+    }
+}
+
+static double measure(Benchmark_Fn fn, size_t iterations) {
+    uint64_t best = UINT64_MAX;
+    fn(iterations / 10 + 1);    // warm up
+    for (size_t round = 0; round < ROUNDS; round++) {
+        const uint64_t start = Benchmark_now();
+        fn(iterations);
+        const uint64_t elapsed = Benchmark_now() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    return (double) best / (double) iterations;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t iterations = Benchmark_iterations(argc, argv, 1000000);
+
+    printf("alligator backend: %s, iterations: %zu\n", BACKEND, iterations);
+    printf("%-40s %10.2f ns/op\n", "malloc/free (libc, reference)", measure(libcCycle, iterations));
+    printf("%-40s %10.2f ns/op\n", "Alligator_malloc/Alligator_free", measure(alligatorCycle, iterations));
+    printf("%-40s %10.2f ns/op\n", "AdderClosure new/call/delete", measure(closureCycle, iterations));
+
+    const struct AlligatorStats stats = Alligator_stats();
+    if (stats.allocations > 0) {
+        printf("\nallocations: %zu, frees: %zu, live bytes: %zu, live objects: %zu, high watermark: %zu bytes\n",
+               stats.allocations, stats.frees, stats.liveBytes, stats.liveObjects, stats.highWatermark);
+        for (size_t i = 0; i < ALLIGATOR_STATS_BUCKETS; i++) {
+            if (stats.histogram[i] > 0) {
+                printf("  < %10zu bytes: %zu\n", (size_t) 1 << i, stats.histogram[i]);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <adder.h>
+#include "benchmark.h"
+
+#if defined(ALLIGATOR_BACKEND_SLAB)
+#define BACKEND "slab"
+#else
+#define BACKEND "libc"
+#endif
+
+#define BATCH   64
+
+/*
+ * Every thread repeatedly creates, calls and deletes closures; in the cross-thread mode each thread deletes
+ * the closures created by its neighbour in the previous round, so that every object is freed by a thread
+ * other than the one that allocated it.
+ */
+struct Worker {
+    pthread_t thread;
+    size_t index;
+    size_t threads;
+    size_t iterations;
+    struct AdderClosure *batch[BATCH];
+};
+
+static struct Worker *workers;
+static pthread_barrier_t barrier;
+
+static void *localCycle(void *argument) {
+    struct Worker *self = argument;
+    pthread_barrier_wait(&barrier);
+    for (size_t i = 0; i < self->iterations; i++) {
+        struct AdderClosure *adder = AdderClosure_new((int) i);
+        struct AdderResult *result = Result_unwrap(AdderClosure_call(adder, 1));
+        Benchmark_use(AdderResult_get(result));
+        AdderResult_delete(result);
+        AdderClosure_delete(adder);
+    }
+    return NULL;
+}
+
+static void *crossCycle(void *argument) {
+    struct Worker *self = argument;
+    struct Worker *neighbour = &workers[(self->index + 1) % self->threads];
+    pthread_barrier_wait(&barrier);
+    for (size_t i = 0; i < self->iterations; i += BATCH) {
+        for (size_t k = 0; k < BATCH; k++) {
+            struct AdderClosure *adder = AdderClosure_new((int) k);
+            struct AdderResult *result = Result_unwrap(AdderClosure_call(adder, 1));
+            Benchmark_use(AdderResult_get(result));
+            AdderResult_delete(result);
+            self->batch[k] = adder;
+        }
+        pthread_barrier_wait(&barrier);
+        for (size_t k = 0; k < BATCH; k++) {
+            AdderClosure_delete(neighbour->batch[k]);
+        }
+        pthread_barrier_wait(&barrier);
+    }
+    return NULL;
+}
+
+static double run(void *(*cycle)(void *), size_t threads, size_t iterations) {
+    workers = calloc(threads, sizeof(*workers));
+    pthread_barrier_init(&barrier, NULL, (unsigned) threads + 1);
+    for (size_t i = 0; i < threads; i++) {
+        workers[i] = (struct Worker) {.index=i, .threads=threads, .iterations=iterations};
+        pthread_create(&workers[i].thread, NULL, cycle, &workers[i]);
+    }
+    const uint64_t start = Benchmark_now();
+    pthread_barrier_wait(&barrier);
+    if (crossCycle == cycle) {
+        // the main thread takes part in the barriers of every round without doing any work
+        for (size_t i = 0; i < iterations; i += BATCH) {
+            pthread_barrier_wait(&barrier);
+            pthread_barrier_wait(&barrier);
+        }
+    }
+    for (size_t i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    const uint64_t elapsed = Benchmark_now() - start;
+    pthread_barrier_destroy(&barrier);
+    free(workers);
+    return (double) (threads * iterations) / ((double) elapsed / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t iterations = Benchmark_iterations(argc, argv, 1000000) / BATCH * BATCH;
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t maxThreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : (size_t) (cores > 0 ? cores : 1);
+
+    printf("alligator backend: %s, iterations per thread: %zu, cores: %ld\n", BACKEND, iterations, cores);
+    printf("%-8s %-7s %16s %22s\n", "mode", "threads", "total ops/s", "ops/s per busy core");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        const size_t busy = (long) threads < cores ? threads : (size_t) cores;
+        const double local = run(localCycle, threads, iterations);
+        const double cross = run(crossCycle, threads, iterations);
+        printf("%-8s %-7zu %16.0f %22.0f\n", "local", threads, local, local / (double) busy);
+        printf("%-8s %-7zu %16.0f %22.0f\n", "cross", threads, cross, cross / (double) busy);
+        if (threads < maxThreads && threads * 2 > maxThreads) {
+            threads = maxThreads / 2;   // always measure maxThreads too
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Minimal helpers shared by the benchmarks.
+ */
+
+#pragma once
+
+#include <time.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#endif
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Prevents the compiler from optimizing away the computation of value.
+ */
+#define Benchmark_use(value) \
+    __asm__ __volatile__("" : : "g"(value) : "memory")
+
+/**
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static inline uint64_t Benchmark_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * Reads the number of iterations from the first command line argument, falling back to defaultIterations.
+ */
+static inline size_t Benchmark_iterations(int argc, char *argv[], size_t defaultIterations) {
+    return (argc > 1) ? strtoul(argv[1], NULL, 10) : defaultIterations;
+}
+
+/**
+ * Opens a counter of the user-space instructions retired by the calling thread.
+ * Returns a negative value if hardware counters are not available, e.g. on virtual machines or non-Linux systems.
+ */
+static inline int Benchmark_openInstructionsCounter(void) {
+#if defined(__linux__)
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Reads a counter opened with `Benchmark_openInstructionsCounter`, returns 0 if the counter is not available.
+ */
+static inline uint64_t Benchmark_readCounter(int counter) {
+    uint64_t value = 0;
+#if defined(__linux__)
+    if (counter < 0 || sizeof(value) != read(counter, &value, sizeof(value))) {
+        value = 0;
+    }
+#else
+    (void) counter;
+#endif
+    return value;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,35 @@
+add_executable(alligator-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/alligator-bench.c)
+target_link_libraries(alligator-bench PRIVATE adder alligator)
+
+find_package(Threads REQUIRED)
+add_executable(alligator-threads-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/alligator-threads-bench.c)
+target_link_libraries(alligator-threads-bench PRIVATE adder alligator Threads::Threads)
+
+add_executable(option-result-bench
+        ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/option-result-bench.c
+        ${CMAKE_CURRENT_LIST_DIR}/option-result-inline.c ${CMAKE_CURRENT_LIST_DIR}/option-result-outline.c)
+target_link_libraries(option-result-bench PRIVATE option result)
+
+add_executable(closure-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/closure-bench.c)
+target_link_libraries(closure-bench PRIVATE adder closure alligator)
+if (CMAKE_C_COMPILER_ID MATCHES "GNU|Clang" AND NOT APPLE)
+    # counts the calls to the alligator allocation functions by wrapping them at link time
+    target_compile_definitions(closure-bench PRIVATE CLOSURE_BENCH_COUNT_ALLOCATIONS)
+    target_link_libraries(closure-bench PRIVATE
+            -Wl,--wrap=Alligator_malloc -Wl,--wrap=Alligator_calloc -Wl,--wrap=Alligator_realloc)
+endif ()
+
+add_executable(executor-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/executor-bench.c)
+target_link_libraries(executor-bench PRIVATE closure Threads::Threads)
+
+add_executable(signal-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/signal-bench.c)
+target_link_libraries(signal-bench PRIVATE closure Threads::Threads)
+
+add_executable(pipeline-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/pipeline-bench.c)
+target_link_libraries(pipeline-bench PRIVATE closure Threads::Threads)
+
+add_executable(queue-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/queue-bench.c)
+target_link_libraries(queue-bench PRIVATE closure Threads::Threads)
+
+add_executable(persistent-memo-bench ${CMAKE_CURRENT_LIST_DIR}/benchmark.h ${CMAKE_CURRENT_LIST_DIR}/persistent-memo-bench.c)
+target_link_libraries(persistent-memo-bench PRIVATE closure)
@@ -0,0 +1,550 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Closure micro-benchmarks.
+ *
+ * Usage: closure-bench [--csv | --json] [iterations]
+ *
+ * Every benchmark reports the best time per operation over a few rounds and the number of calls to the alligator
+ * allocation functions per operation; the latter is available only if the toolchain supports `--wrap`.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <closure.h>
+#include <closure_memo.h>
+#include <closure_lazy.h>
+#include <closure_instrumentation.h>
+#include <closure_vector.h>
+#include <closure_wheel.h>
+#include <closure_generator.h>
+#include <adder.h>
+#include <alligator/alligator.h>
+#include "benchmark.h"
+
+#define ROUNDS  5
+#define BATCH   1024
+
+/*
+ * Allocations counting
+ */
+static size_t allocations = 0;
+
+#if defined(CLOSURE_BENCH_COUNT_ALLOCATIONS)
+
+extern Option __real_Alligator_malloc(size_t size);
+
+extern Option __real_Alligator_calloc(size_t numberOfMembers, size_t memberSize);
+
+extern Option __real_Alligator_realloc(void *memory, size_t newSize);
+
+Option __wrap_Alligator_malloc(size_t size) {
+    allocations++;
+    return __real_Alligator_malloc(size);
+}
+
+Option __wrap_Alligator_calloc(size_t numberOfMembers, size_t memberSize) {
+    allocations++;
+    return __real_Alligator_calloc(numberOfMembers, memberSize);
+}
+
+Option __wrap_Alligator_realloc(void *memory, size_t newSize) {
+    allocations++;
+    return __real_Alligator_realloc(memory, newSize);
+}
+
+#endif
+
+/*
+ * Fixtures
+ */
+static struct Closure *closures[BATCH];
+static Option batchArguments[BATCH];
+static Result batchResults[BATCH];
+static int adderArguments[BATCH];
+static struct AdderClosure *adder;
+static struct ClosureVector *vector;
+static struct ClosureWheel *wheel;
+static Result_Value generated[BATCH];
+
+static Result callImpl(Option environment, Option arguments) {
+    const int *x = Option_unwrap(environment);
+    return Result_ok((Result_Value) (intptr_t) (*x + (int) (intptr_t) Option_getOr(arguments, NULL)));
+}
+
+static void callBatchImpl(Option environment, const Option *arguments, Result *out, size_t n) {
+    const int x = *(const int *) Option_unwrap(environment);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = Result_ok((Result_Value) (intptr_t) (x + (int) (intptr_t) Option_getOr(arguments[i], NULL)));
+    }
+}
+
+static void deleteImpl(Option environment) {
+    (void) environment;
+}
+
+static Result (*volatile rawCallFn)(Option, Option) = callImpl;
+
+static const struct ClosureClass fixtureClass = {.name="fixture", .call=callImpl, .callBatch=callBatchImpl};
+
+static int fixtureEnvironment = 5;
+
+static void prepare(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        closures[i] = Closure_new(Option_some(&fixtureEnvironment), callImpl, deleteImpl);
+    }
+}
+
+static void prepareBatch(void) {
+    closures[0] = Closure_new(Option_some(&fixtureEnvironment), callImpl, deleteImpl);
+    for (size_t i = 0; i < BATCH; i++) {
+        batchArguments[i] = Option_some((Option_Value) (intptr_t) i);
+    }
+}
+
+static void prepareNativeBatch(void) {
+    prepareBatch();
+    Closure_setCallBatch(closures[0], callBatchImpl);
+}
+
+static void releaseBatch(void) {
+    Closure_delete(closures[0]);
+}
+
+static size_t memoHash(Option arguments) {
+    return (size_t) (intptr_t) Option_getOr(arguments, NULL) * 0x9E3779B97F4A7C15u;
+}
+
+static bool memoEquals(Option a, Option b) {
+    return Option_getOr(a, NULL) == Option_getOr(b, NULL);
+}
+
+static void prepareMemoWith(bool threadSafe) {
+    const struct ClosureMemoOptions options = {
+            .capacity=64, .threadSafe=threadSafe, .hash=memoHash, .equals=memoEquals
+    };
+    closures[0] = ClosureMemo_new(Closure_new(Option_some(&fixtureEnvironment), callImpl, deleteImpl), &options);
+    for (size_t i = 0; i < BATCH; i++) {
+        batchArguments[i] = Option_some((Option_Value) (intptr_t) (i % 64));
+    }
+}
+
+static void prepareMemo(void) {
+    prepareMemoWith(false);
+}
+
+static void prepareSharedMemo(void) {
+    prepareMemoWith(true);
+}
+
+static void prepareLazy(void) {
+    prepare();
+    for (size_t i = 0; i < BATCH; i++) {
+        closures[i] = ClosureLazy_new(closures[i], NULL);
+    }
+}
+
+static void prepareLazyValue(void) {
+    prepareLazy();
+    for (size_t i = 0; i < BATCH; i++) {
+        Benchmark_use(Closure_call(closures[i]));
+    }
+}
+
+/*
+ * Event handlers of a few different kinds, shuffled so that the target of each call is hard to predict.
+ */
+#define HANDLER(name, k)                                                        \
+    static Result name(Option environment, Option arguments) {                  \
+        (void) arguments;                                                       \
+        const int *x = Option_unwrap(environment);                              \
+        return Result_ok((Result_Value) (intptr_t) (*x * (k)));                 \
+    }
+
+HANDLER(handlerA, 2)
+
+HANDLER(handlerB, 3)
+
+HANDLER(handlerC, 5)
+
+HANDLER(handlerD, 7)
+
+static const struct ClosureClass handlerClasses[] = {
+        {.name="handlerA", .environmentSize=sizeof(int), .call=handlerA},
+        {.name="handlerB", .environmentSize=sizeof(int), .call=handlerB},
+        {.name="handlerC", .environmentSize=sizeof(int), .call=handlerC},
+        {.name="handlerD", .environmentSize=sizeof(int), .call=handlerD},
+};
+
+static const struct ClosureClass *handlerClass(size_t i) {
+    const uint32_t hash = (uint32_t) i * 2654435761u;
+    return &handlerClasses[(hash >> 16u) % (sizeof(handlerClasses) / sizeof(handlerClasses[0]))];
+}
+
+static void prepareHandlers(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        const int x = (int) i;
+        closures[i] = Closure_newFromClass(handlerClass(i), Option_some((Option_Value) &x));
+    }
+}
+
+static void prepareVector(void) {
+    vector = ClosureVector_new();
+    for (size_t i = 0; i < BATCH; i++) {
+        const int x = (int) i;
+        ClosureVector_emplace(vector, handlerClass(i), Option_some((Option_Value) &x));
+    }
+}
+
+static void releaseVector(void) {
+    ClosureVector_delete(vector);
+}
+
+static void prepareWheel(void) {
+    prepareBatch();
+    wheel = ClosureWheel_new();
+}
+
+static void releaseWheel(void) {
+    ClosureWheel_delete(wheel);
+    releaseBatch();
+}
+
+static void prepareRange(void) {
+    closures[0] = ClosureGenerator_range(0, INTPTR_MAX, 1);
+}
+
+static void prepareAdder(void) {
+    adder = AdderClosure_new(5);
+    for (size_t i = 0; i < BATCH; i++) {
+        adderArguments[i] = (int) i;
+    }
+}
+
+static void releaseAdder(void) {
+    AdderClosure_delete(adder);
+}
+
+static void release(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        Closure_delete(closures[i]);
+    }
+}
+
+#if defined(CLOSURE_INSTRUMENTATION)
+
+static void prepareInstrumented(void) {
+    prepare();
+    ClosureInstrumentation_setEnabled(true);
+}
+
+static void releaseInstrumented(void) {
+    ClosureInstrumentation_setEnabled(false);
+    release();
+}
+
+#endif
+
+/*
+ * Benchmarks, each one runs BATCH operations.
+ * setup and teardown are executed outside of the measured region.
+ */
+struct Benchmark {
+    const char *name;
+    void (*setup)(void);
+    void (*run)(void);
+    void (*teardown)(void);
+};
+
+static void rawCall(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        Benchmark_use(rawCallFn(Option_some(&fixtureEnvironment), Option_some((Option_Value) (intptr_t) i)));
+    }
+}
+
+static void closureNew(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        closures[i] = Closure_new(Option_some(&fixtureEnvironment), callImpl, deleteImpl);
+    }
+}
+
+static void closureNewFromClass(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        closures[i] = Closure_newFromClass(&fixtureClass, Option_some(&fixtureEnvironment));
+    }
+}
+
+static void closureNewWithEnvironmentSize(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        closures[i] = Closure_newWithEnvironmentSize(sizeof(int), callImpl, deleteImpl);
+        *(int *) Option_unwrap(Closure_getEnvironment(closures[i])) = (int) i;
+    }
+}
+
+static void closureCall(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        Benchmark_use(Closure_call(closures[i]));
+    }
+}
+
+static void closureCallWith(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        Benchmark_use(Closure_callWith(closures[i], Option_some((Option_Value) (intptr_t) i)));
+    }
+}
+
+static void closureCallWithEach(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        batchResults[i] = Closure_callWith(closures[0], batchArguments[i]);
+    }
+    Benchmark_use(batchResults);
+}
+
+static void closureCallBatch(void) {
+    Closure_callBatch(closures[0], batchArguments, batchResults, BATCH);
+    Benchmark_use(batchResults);
+}
+
+static void handlersCallEach(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        batchResults[i] = Closure_call(closures[i]);
+    }
+    Benchmark_use(batchResults);
+}
+
+static void vectorCallAll(void) {
+    ClosureVector_callAll(vector, None, batchResults);
+    Benchmark_use(batchResults);
+}
+
+static void wheelScheduleCancel(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        const uint64_t delay = 1 + (i * 7919u) % 100000u;
+        Benchmark_use(ClosureWheel_cancel(wheel, ClosureWheel_schedule(wheel, Closure_retain(closures[0]), delay, 0)));
+    }
+}
+
+static void generatorCallEach(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        generated[i] = Result_unwrap(Closure_call(closures[0]));
+    }
+    Benchmark_use(generated);
+}
+
+static void generatorNextN(void) {
+    Benchmark_use(ResultTyped_unwrap(ResultSize, ClosureGenerator_nextN(closures[0], generated, BATCH)));
+    Benchmark_use(generated);
+}
+
+static void adderCallEach(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        struct AdderResult *result = Result_unwrap(AdderClosure_call(adder, adderArguments[i]));
+        Benchmark_use(AdderResult_get(result));
+        AdderResult_delete(result);
+    }
+}
+
+static void adderCallInto(void) {
+    int sum;
+    for (size_t i = 0; i < BATCH; i++) {
+        Benchmark_use(*(int *) Result_unwrap(AdderClosure_callInto(adder, adderArguments[i], &sum)));
+    }
+}
+
+static void adderCallBatch(void) {
+    AdderClosure_callBatch(adder, adderArguments, batchResults, BATCH);
+    for (size_t i = 0; i < BATCH; i++) {
+        struct AdderResult *result = Result_unwrap(batchResults[i]);
+        Benchmark_use(AdderResult_get(result));
+        AdderResult_delete(result);
+    }
+}
+
+static void closureRetainRelease(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        Closure_release(Closure_retain(closures[0]));
+    }
+}
+
+static void closureRetainReleaseNonAtomic(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        Closure_releaseNonAtomic(Closure_retainNonAtomic(closures[0]));
+    }
+}
+
+static void closureDelete(void) {
+    release();
+}
+
+static void adderRoundTrip(void) {
+    for (size_t i = 0; i < BATCH; i++) {
+        struct AdderClosure *adder = AdderClosure_new((int) i);
+        struct AdderResult *result = Result_unwrap(AdderClosure_call(adder, 1));
+        Benchmark_use(AdderResult_get(result));
+        AdderResult_delete(result);
+        AdderClosure_delete(adder);
+    }
+}
+
+static const struct Benchmark BENCHMARKS[] = {
+        {"raw function pointer call",           NULL,                rawCall,                        NULL},
+        {"Closure_new",                         NULL,                closureNew,                     release},
+        {"Closure_newFromClass",                NULL,                closureNewFromClass,            release},
+        {"Closure_newWithEnvironmentSize",      NULL,                closureNewWithEnvironmentSize,  release},
+        {"Closure_call",                        prepare,             closureCall,                    release},
+        {"Closure_callWith",                    prepare,             closureCallWith,                release},
+#if defined(CLOSURE_INSTRUMENTATION)  // otherwise enabling instrumentation does nothing: this would be the plain call
+        {"Closure_callWith, instrumented",      prepareInstrumented, closureCallWith,                releaseInstrumented},
+#endif
+        {"Closure_callWith, one per element",   prepareBatch,        closureCallWithEach,            releaseBatch},
+        {"Closure_callBatch, generic loop",     prepareBatch,        closureCallBatch,               releaseBatch},
+        {"Closure_callBatch, native",           prepareNativeBatch,  closureCallBatch,               releaseBatch},
+        {"mixed handlers, one call each",       prepareHandlers,     handlersCallEach,               release},
+        {"ClosureVector_callAll",               prepareVector,       vectorCallAll,                  releaseVector},
+        {"ClosureMemo hit",                     prepareMemo,         closureCallWithEach,            releaseBatch},
+        {"ClosureMemo hit, thread-safe",        prepareSharedMemo,   closureCallWithEach,            releaseBatch},
+        {"ClosureLazy first call",              prepareLazy,         closureCall,                    release},
+        {"ClosureLazy evaluated",               prepareLazyValue,    closureCall,                    release},
+        {"generator range, one call each",      prepareRange,        generatorCallEach,              releaseBatch},
+        {"ClosureGenerator_nextN, range",       prepareRange,        generatorNextN,                 releaseBatch},
+        {"Closure_retain + Closure_release",    prepareBatch,        closureRetainRelease,           releaseBatch},
+        {"Closure_retain/releaseNonAtomic",     prepareBatch,        closureRetainReleaseNonAtomic,  releaseBatch},
+        {"ClosureWheel schedule + cancel",      prepareWheel,        wheelScheduleCancel,            releaseWheel},
+        {"Closure_delete",                      prepare,             closureDelete,                  NULL},
+        {"AdderClosure round trip",             NULL,                adderRoundTrip,                 NULL},
+        {"AdderClosure_call, one per element",  prepareAdder,        adderCallEach,                  releaseAdder},
+        {"AdderClosure_callInto",               prepareAdder,        adderCallInto,                  releaseAdder},
+        {"AdderClosure_callBatch",              prepareAdder,        adderCallBatch,                 releaseAdder},
+};
+
+/*
+ * Reporting
+ */
+enum Format {
+    Format_Table, Format_Csv, Format_Json
+};
+
+struct Measure {
+    double nanosecondsPerOperation;
+    double allocationsPerOperation;
+};
+
+static struct Measure measure(const struct Benchmark *benchmark, size_t iterations) {
+    const size_t batches = (iterations + BATCH - 1) / BATCH;
+    uint64_t best = UINT64_MAX;
+    size_t measuredAllocations = 0;
+    for (size_t round = 0; round <= ROUNDS; round++) {  // round 0 warms up
+        uint64_t elapsed = 0;
+        measuredAllocations = 0;
+        for (size_t batch = 0; batch < batches; batch++) {
+            if (benchmark->setup) {
+                benchmark->setup();
+            }
+            const size_t allocationsBefore = allocations;
+            const uint64_t start = Benchmark_now();
+            benchmark->run();
+            elapsed += Benchmark_now() - start;
+            measuredAllocations += allocations - allocationsBefore;
+            if (benchmark->teardown) {
+                benchmark->teardown();
+            }
+        }
+        if (round > 0 && elapsed < best) {
+            best = elapsed;
+        }
+    }
+    const double operations = (double) (batches * BATCH);
+    return (struct Measure) {
+            .nanosecondsPerOperation=(double) best / operations,
+            .allocationsPerOperation=(double) measuredAllocations / operations
+    };
+}
+
+static void report(enum Format format, const struct Benchmark *benchmark, size_t index, size_t iterations,
+                   struct Measure measure) {
+#if defined(CLOSURE_BENCH_COUNT_ALLOCATIONS)
+    const bool countAllocations = true;
+#else
+    const bool countAllocations = false;
+#endif
+    switch (format) {
+        case Format_Csv:
+            if (0 == index) {
+                printf("name,iterations,ns_per_op,allocations_per_op\n");
+            }
+            printf("%s,%zu,%.3f,", benchmark->name, iterations, measure.nanosecondsPerOperation);
+            if (countAllocations) {
+                printf("%.3f", measure.allocationsPerOperation);
+            }
+            printf("\n");
+            break;
+        case Format_Json:
+            printf("%s{\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, \"allocations_per_op\": ",
+                   0 == index ? "[\n  " : "  ", benchmark->name, iterations, measure.nanosecondsPerOperation);
+            if (countAllocations) {
+                printf("%.3f}", measure.allocationsPerOperation);
+            } else {
+                printf("null}");
+            }
+            printf("%s\n", index + 1 < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]) ? "," : "\n]");
+            break;
+        default:
+            if (0 == index) {
+                printf("%-40s %12s %14s\n", "benchmark", "ns/op", "allocations/op");
+            }
+            printf("%-40s %12.2f ", benchmark->name, measure.nanosecondsPerOperation);
+            if (countAllocations) {
+                printf("%14.2f\n", measure.allocationsPerOperation);
+            } else {
+                printf("%14s\n", "n/a");
+            }
+            break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    enum Format format = Format_Table;
+    size_t iterations = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp("--csv", argv[i])) {
+            format = Format_Csv;
+        } else if (0 == strcmp("--json", argv[i])) {
+            format = Format_Json;
+        } else {
+            iterations = strtoul(argv[i], NULL, 10);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); i++) {
+        const size_t operations = (iterations + BATCH - 1) / BATCH * BATCH;
+        report(format, &BENCHMARKS[i], i, operations, measure(&BENCHMARKS[i], iterations));
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Executor throughput on 1 to N worker threads.
+ *
+ * Usage: executor-bench [tasks] [max threads]
+ *
+ * - submit: the main thread submits every closure and then waits for every future, exercising the injection stacks.
+ * - spawn: closures spawn a binary tree of closures from inside the workers, exercising the deques and stealing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <unistd.h>
+#include <closure.h>
+#include <closure_executor.h>
+#include "benchmark.h"
+
+#define WORK    64
+#define BATCH   1024
+
+struct Task {
+    struct ClosureExecutor *executor;
+    size_t depth;
+};
+
+static size_t completed = 0;
+
+static uint64_t work(uint64_t seed) {
+    for (size_t i = 0; i < WORK; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+    }
+    return seed;
+}
+
+static Result submitImpl(Option environment, Option arguments) {
+    (void) arguments;
+    const struct Task *task = Option_unwrap(environment);
+    return Result_ok((Result_Value) (uintptr_t) work(task->depth + 1));
+}
+
+static void deleteImpl(Option environment) {
+    (void) environment;
+}
+
+static struct Closure *Task_new(struct ClosureExecutor *executor, size_t depth,
+                                Result (*callFn)(Option, Option)) {
+    struct Closure *closure = Closure_newWithEnvironmentSize(sizeof(struct Task), callFn, deleteImpl);
+    struct Task *task = Option_unwrap(Closure_getEnvironment(closure));
+    task->executor = executor;
+    task->depth = depth;
+    return closure;
+}
+
+static Result spawnImpl(Option environment, Option arguments) {
+    (void) arguments;
+    const struct Task *task = Option_unwrap(environment);
+    if (task->depth > 0) {
+        ClosureFuture_delete(ClosureExecutor_submit(task->executor, Task_new(task->executor, task->depth - 1, spawnImpl)));
+        ClosureFuture_delete(ClosureExecutor_submit(task->executor, Task_new(task->executor, task->depth - 1, spawnImpl)));
+    }
+    Benchmark_use(work(task->depth + 1));
+    __atomic_fetch_add(&completed, 1, __ATOMIC_RELEASE);
+    return Result_ok(NULL);
+}
+
+static double submit(size_t threads, size_t tasks) {
+    static struct ClosureFuture *futures[BATCH];
+    struct ClosureExecutor *executor = ClosureExecutor_new(threads);
+    const uint64_t start = Benchmark_now();
+    for (size_t i = 0; i < tasks; i += BATCH) {
+        for (size_t k = 0; k < BATCH; k++) {
+            futures[k] = ClosureExecutor_submit(executor, Task_new(executor, k, submitImpl));
+        }
+        for (size_t k = 0; k < BATCH; k++) {
+            Benchmark_use(Result_unwrap(ClosureFuture_wait(futures[k])));
+            ClosureFuture_delete(futures[k]);
+        }
+    }
+    const uint64_t elapsed = Benchmark_now() - start;
+    ClosureExecutor_delete(executor);
+    return (double) tasks / ((double) elapsed / 1e9);
+}
+
+static double spawn(size_t threads, size_t tasks) {
+    size_t depth = 0;
+    while (((size_t) 2 << (depth + 1)) - 1 <= tasks) {
+        depth++;
+    }
+    const size_t total = ((size_t) 2 << depth) - 1;
+    struct ClosureExecutor *executor = ClosureExecutor_new(threads);
+    __atomic_store_n(&completed, 0, __ATOMIC_RELAXED);
+    const uint64_t start = Benchmark_now();
+    ClosureFuture_delete(ClosureExecutor_submit(executor, Task_new(executor, depth, spawnImpl)));
+    while (__atomic_load_n(&completed, __ATOMIC_ACQUIRE) < total) {
+        sched_yield();
+    }
+    const uint64_t elapsed = Benchmark_now() - start;
+    ClosureExecutor_delete(executor);
+    return (double) total / ((double) elapsed / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t tasks = Benchmark_iterations(argc, argv, 1 << 20) / BATCH * BATCH;
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t maxThreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : (size_t) (cores > 0 ? cores : 1);
+
+    printf("tasks: %zu, work per task: %d xorshift rounds, cores: %ld\n", tasks, WORK, cores);
+    printf("%-8s %-7s %16s\n", "mode", "threads", "tasks/s");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        printf("%-8s %-7zu %16.0f\n", "submit", threads, submit(threads, tasks));
+        printf("%-8s %-7zu %16.0f\n", "spawn", threads, spawn(threads, tasks));
+        if (threads < maxThreads && threads * 2 > maxThreads) {
+            threads = maxThreads / 2;   // always measure maxThreads too
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include "benchmark.h"
+
+#define ROUNDS  5
+
+extern long inlinePath(size_t iterations);
+
+extern long outlinePath(size_t iterations);
+
+extern long typedPath(size_t iterations);
+
+extern long compactPath(size_t iterations);
+
+extern long chainPath(size_t iterations);
+
+extern long compactChainPath(size_t iterations);
+
+static void measure(const char *name, long (*path)(size_t), size_t iterations, int counter) {
+    uint64_t bestTime = UINT64_MAX, bestInstructions = UINT64_MAX;
+    Benchmark_use(path(iterations / 10 + 1));   // warm up
+    for (size_t round = 0; round < ROUNDS; round++) {
+        const uint64_t startInstructions = Benchmark_readCounter(counter);
+        const uint64_t start = Benchmark_now();
+        Benchmark_use(path(iterations));
+        const uint64_t elapsed = Benchmark_now() - start;
+        const uint64_t instructions = Benchmark_readCounter(counter) - startInstructions;
+        bestTime = elapsed < bestTime ? elapsed : bestTime;
+        bestInstructions = instructions < bestInstructions ? instructions : bestInstructions;
+    }
+    printf("%-36s %10.2f ns/call", name, (double) bestTime / (double) iterations);
+    if (counter >= 0) {
+        printf(" %10.2f instructions/call", (double) bestInstructions / (double) iterations);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    const size_t iterations = Benchmark_iterations(argc, argv, 10000000);
+    const int counter = Benchmark_openInstructionsCounter();
+
+    printf("iterations: %zu, instructions counter: %s\n", iterations, counter >= 0 ? "available" : "not available");
+    measure("out-of-line Option/Result (before)", outlinePath, iterations, counter);
+    measure("inline Option/Result (after)", inlinePath, iterations, counter);
+    measure("typed ResultInt", typedPath, iterations, counter);
+    measure("CompactOption arguments", compactPath, iterations, counter);
+    measure("Result map/chain", chainPath, iterations, counter);
+    measure("CompactResult map/chain", compactChainPath, iterations, counter);
+    return 0;
+}
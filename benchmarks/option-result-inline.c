@@ -0,0 +1,170 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <option/option.h>
+#include <option/option_compact.h>
+#include <result/result.h>
+#include <result/result_compact.h>
+#include <result/result_typed.h>
+
+/*
+ * Mimics the adder example: arguments baked on the caller side, unwrapped on the callee side that returns a Result,
+ * the callee is reached through a pointer like Closure_callWith does.
+ */
+struct Environment {
+    int x;
+};
+
+struct Arguments {
+    int y;
+};
+
+static Result callImpl(Option environment, Option arguments) {
+    const struct Environment *self = Option_unwrap(environment);
+    const struct Arguments *other = Option_unwrap(arguments);
+    return Result_ok((Result_Value) (intptr_t) (self->x + other->y));
+}
+
+static Result (*volatile callFn)(Option, Option) = callImpl;
+
+long inlinePath(size_t iterations) {
+    struct Environment environment = {.x=5};
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        const Result result = callFn(Option_some(&environment), Option_some(&(struct Arguments) {.y=(int) i}));
+        sum += (intptr_t) Result_unwrap(result);
+    }
+    return sum;
+}
+
+/*
+ * Same shape as inlinePath, but the int travels inline in a ResultInt instead of being boxed in a Result.
+ */
+static ResultInt typedCallImpl(Option environment, Option arguments) {
+    const struct Environment *self = Option_unwrap(environment);
+    const struct Arguments *other = Option_unwrap(arguments);
+    return ResultInt_ok(self->x + other->y);
+}
+
+static ResultInt (*volatile typedCallFn)(Option, Option) = typedCallImpl;
+
+long typedPath(size_t iterations) {
+    struct Environment environment = {.x=5};
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        const ResultInt result = typedCallFn(Option_some(&environment), Option_some(&(struct Arguments) {.y=(int) i}));
+        sum += ResultTyped_unwrap(ResultInt, result);
+    }
+    return sum;
+}
+
+/*
+ * Same shape as inlinePath, but the environment and the arguments travel as CompactOption, one register each.
+ */
+static Result compactCallImpl(CompactOption environment, CompactOption arguments) {
+    const struct Environment *self = CompactOption_unwrap(environment);
+    const struct Arguments *other = CompactOption_unwrap(arguments);
+    return Result_ok((Result_Value) (intptr_t) (self->x + other->y));
+}
+
+static Result (*volatile compactCallFn)(CompactOption, CompactOption) = compactCallImpl;
+
+long compactPath(size_t iterations) {
+    struct Environment environment = {.x=5};
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        const Result result = compactCallFn(
+                CompactOption_some(&environment), CompactOption_some(&(struct Arguments) {.y=(int) i})
+        );
+        sum += (intptr_t) Result_unwrap(result);
+    }
+    return sum;
+}
+
+/*
+ * A chain of Result_map and Result_chain over out-of-line steps, against the same chain over CompactResult.
+ * Values are kept even so that they can be wrapped by a CompactResult; the chains are exported to be inspected with
+ * e.g. `nm -S option-result-bench | grep Chain`.
+ */
+__attribute__((__noinline__))
+static Result increment(const Result_Value value) {
+    return Result_ok((Result_Value) ((intptr_t) value + 2));
+}
+
+__attribute__((__noinline__))
+static Result bound(const Result_Value value) {
+    return (intptr_t) value < 0 ? Result_error(DomainError) : Result_ok(value);
+}
+
+__attribute__((__noinline__))
+Result resultChain(const Result_Value value) {
+    Result result = Result_ok(value);
+    result = Result_map(result, increment);
+    result = Result_chain(result, bound);
+    result = Result_map(result, increment);
+    result = Result_chain(result, bound);
+    result = Result_map(result, increment);
+    return Result_chain(result, bound);
+}
+
+__attribute__((__noinline__))
+static CompactResult compactIncrement(const Result_Value value) {
+    return CompactResult_ok((Result_Value) ((intptr_t) value + 2));
+}
+
+__attribute__((__noinline__))
+static CompactResult compactBound(const Result_Value value) {
+    return (intptr_t) value < 0 ? CompactResult_error(DomainError) : CompactResult_ok(value);
+}
+
+__attribute__((__noinline__))
+CompactResult compactResultChain(const Result_Value value) {
+    CompactResult result = CompactResult_ok(value);
+    result = CompactResult_map(result, compactIncrement);
+    result = CompactResult_chain(result, compactBound);
+    result = CompactResult_map(result, compactIncrement);
+    result = CompactResult_chain(result, compactBound);
+    result = CompactResult_map(result, compactIncrement);
+    return CompactResult_chain(result, compactBound);
+}
+
+long chainPath(size_t iterations) {
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        sum += (intptr_t) Result_unwrap(resultChain((Result_Value) (intptr_t) (2 * i)));
+    }
+    return sum;
+}
+
+long compactChainPath(size_t iterations) {
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        sum += (intptr_t) CompactResult_unwrap(compactResultChain((Result_Value) (intptr_t) (2 * i)));
+    }
+    return sum;
+}
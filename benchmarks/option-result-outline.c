@@ -0,0 +1,66 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Same code as option-result-inline.c, but every Option and Result function is an out-of-line call.
+ */
+#define OPTION_NO_INLINE
+#define RESULT_NO_INLINE
+
+#include <stdint.h>
+#include <option/option.h>
+#include <result/result.h>
+
+/*
+ * Mimics the adder example: arguments baked on the caller side, unwrapped on the callee side that returns a Result,
+ * the callee is reached through a pointer like Closure_callWith does.
+ */
+struct Environment {
+    int x;
+};
+
+struct Arguments {
+    int y;
+};
+
+static Result callImpl(Option environment, Option arguments) {
+    const struct Environment *self = Option_unwrap(environment);
+    const struct Arguments *other = Option_unwrap(arguments);
+    return Result_ok((Result_Value) (intptr_t) (self->x + other->y));
+}
+
+static Result (*volatile callFn)(Option, Option) = callImpl;
+
+long outlinePath(size_t iterations) {
+    struct Environment environment = {.x=5};
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        const Result result = callFn(Option_some(&environment), Option_some(&(struct Arguments) {.y=(int) i}));
+        sum += (intptr_t) Result_unwrap(result);
+    }
+    return sum;
+}
@@ -0,0 +1,159 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * ClosurePersistentMemo startup time: the time to open the cache file and to answer every key for the first time,
+ * on a cold start with no cache file and on a warm start reopening the file left by the cold one.
+ *
+ * Usage: persistent-memo-bench [keys] [cache file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <closure.h>
+#include <closure_persistent_memo.h>
+#include "benchmark.h"
+
+#define ROUNDS      20000
+#define CAPACITY    (64u << 20u)
+
+/*
+ * A pure and expensive closure of an integer.
+ */
+static Result slowImpl(Option environment, Option arguments) {
+    (void) environment;
+    uint64_t x = (uint64_t) (uintptr_t) Option_unwrap(arguments);
+    for (size_t i = 0; i < ROUNDS; i++) {
+        x ^= x >> 33u;
+        x *= 0xFF51AFD7ED558CCDu;
+    }
+    return Result_ok((Result_Value) (uintptr_t) x);
+}
+
+static const struct ClosureClass slowClass = {
+        .name="Slow",
+        .call=slowImpl,
+};
+
+static size_t encodeArguments(Option arguments, void *buffer, size_t size) {
+    const uint64_t key = (uint64_t) (uintptr_t) Option_unwrap(arguments);
+    if (sizeof(key) <= size) {
+        memcpy(buffer, &key, sizeof(key));
+    }
+    return sizeof(key);
+}
+
+static size_t encodeResult(Result_Value value, void *buffer, size_t size) {
+    const uint64_t x = (uint64_t) (uintptr_t) value;
+    if (sizeof(x) <= size) {
+        memcpy(buffer, &x, sizeof(x));
+    }
+    return sizeof(x);
+}
+
+/*
+ * Zero-copy: the result points straight to the bytes of the value in the mapped file.
+ */
+static Result decodeResult(const void *bytes, size_t size) {
+    (void) size;
+    return Result_ok((Result_Value) bytes);
+}
+
+static struct Closure *openMemo(const char *path, double *elapsed) {
+    const struct ClosurePersistentMemoOptions options = {
+            .path=path,
+            .capacity=CAPACITY,
+            .encodeArguments=encodeArguments,
+            .encodeResult=encodeResult,
+            .decodeResult=decodeResult,
+    };
+    const uint64_t start = Benchmark_now();
+    const Result memo = ClosurePersistentMemo_new(Closure_newFromClass(&slowClass, None), &options);
+    *elapsed = (double) (Benchmark_now() - start) / 1e6;
+    return Result_expect(memo, "unable to open the cache file");
+}
+
+static uint64_t get(struct Closure *closure, size_t key, bool memo) {
+    const Result_Value value = Result_unwrap(Closure_callWith(closure, Option_some((Option_Value) (uintptr_t) key)));
+    uint64_t x;
+    if (memo) {
+        memcpy(&x, value, sizeof(x));
+    } else {
+        x = (uint64_t) (uintptr_t) value;
+    }
+    return x;
+}
+
+static double callAll(struct Closure *closure, size_t keys, bool memo, uint64_t *checksum) {
+    const uint64_t start = Benchmark_now();
+    *checksum = 0;
+    for (size_t key = 1; key <= keys; key++) {
+        *checksum += get(closure, key, memo);
+    }
+    return (double) (Benchmark_now() - start) / 1e6;
+}
+
+static void report(const char *run, double openMilliseconds, double callsMilliseconds, size_t keys) {
+    printf("%-6s %12.3f %12.3f %12.1f\n", run, openMilliseconds, callsMilliseconds, callsMilliseconds * 1e6 / keys);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t keys = Benchmark_iterations(argc, argv, 4096);
+    const char *path = (argc > 2) ? argv[2] : "persistent-memo-bench.cache";
+    uint64_t expected, checksum;
+
+    printf("keys: %zu, rounds per call: %d, cache file: %s\n", keys, ROUNDS, path);
+    printf("%-6s %12s %12s %12s\n", "run", "open ms", "calls ms", "ns/call");
+
+    struct Closure *plain = Closure_newFromClass(&slowClass, None);
+    report("plain", 0, callAll(plain, keys, false, &expected), keys);
+    Closure_delete(plain);
+
+    unlink(path);
+    double openMilliseconds;
+    struct Closure *memo = openMemo(path, &openMilliseconds);
+    report("cold", openMilliseconds, callAll(memo, keys, true, &checksum), keys);
+    Closure_delete(memo);
+    if (checksum != expected) {
+        fprintf(stderr, "cold run: wrong results\n");
+        return EXIT_FAILURE;
+    }
+
+    memo = openMemo(path, &openMilliseconds);
+    report("warm", openMilliseconds, callAll(memo, keys, true, &checksum), keys);
+    const struct ClosurePersistentMemoStats stats = ClosurePersistentMemo_getStats(memo);
+    Closure_delete(memo);
+    if (checksum != expected || stats.recovered != keys || stats.misses != 0) {
+        fprintf(stderr, "warm run: wrong results\n");
+        return EXIT_FAILURE;
+    }
+    printf("recovered entries: %zu, cache file bytes in use: %zu\n", stats.recovered, stats.bytes);
+    unlink(path);
+    return 0;
+}
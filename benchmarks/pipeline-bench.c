@@ -0,0 +1,135 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * ClosurePipeline end-to-end throughput: a chain of 1 to N adder stages, each one adding its own constant to the
+ * values flowing through it, fed by the main thread and drained by a consumer thread.
+ *
+ * Usage: pipeline-bench [values] [max stages]
+ *
+ * - single: values are pushed and popped one at a time.
+ * - batch: values are pushed and popped in batches.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <closure.h>
+#include <closure_pipeline.h>
+#include "benchmark.h"
+
+#define CAPACITY    1024
+#define BATCH       256
+
+struct StageEnvironment {
+    intptr_t x;
+};
+
+struct Consumer {
+    pthread_t thread;
+    struct ClosurePipeline *pipeline;
+    bool batch;
+    intptr_t sum;
+};
+
+static Result stageImpl(Option environment, Option arguments) {
+    const struct StageEnvironment *stageEnvironment = Option_unwrap(environment);
+    return Result_ok((Result_Value) ((intptr_t) Option_unwrap(arguments) + stageEnvironment->x));
+}
+
+static const struct ClosureClass stageClass = {
+        .name="PipelineStage",
+        .environmentSize=sizeof(struct StageEnvironment),
+        .call=stageImpl,
+};
+
+static void *consume(void *argument) {
+    struct Consumer *consumer = argument;
+    Result results[BATCH];
+    size_t n;
+    while ((n = consumer->batch ? ClosurePipeline_popBatch(consumer->pipeline, results, BATCH)
+                                : ClosurePipeline_pop(consumer->pipeline, results)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            consumer->sum += (intptr_t) Result_unwrap(results[i]);
+        }
+    }
+    return NULL;
+}
+
+static double run(size_t stages, size_t values, bool batch) {
+    struct ClosurePipeline *pipeline = ClosurePipeline_new(CAPACITY);
+    for (size_t i = 1; i <= stages; i++) {
+        const struct StageEnvironment environment = {.x=(intptr_t) i};
+        ClosurePipeline_addStage(pipeline, Closure_newFromClass(&stageClass, Option_some((void *) &environment)));
+    }
+    if (!ClosurePipeline_start(pipeline)) {
+        fprintf(stderr, "unable to start the stages\n");
+        exit(EXIT_FAILURE);
+    }
+    struct Consumer consumer = {.pipeline=pipeline, .batch=batch, .sum=0};
+    const uint64_t start = Benchmark_now();
+    pthread_create(&consumer.thread, NULL, consume, &consumer);
+    if (batch) {
+        Result_Value chunk[BATCH];
+        for (size_t i = 0; i < values; i += BATCH) {
+            const size_t n = values - i < BATCH ? values - i : BATCH;
+            for (size_t k = 0; k < n; k++) {
+                chunk[k] = (Result_Value) (intptr_t) (i + k);
+            }
+            ClosurePipeline_pushBatch(pipeline, chunk, n);
+        }
+    } else {
+        for (size_t i = 0; i < values; i++) {
+            ClosurePipeline_push(pipeline, (Result_Value) (intptr_t) i);
+        }
+    }
+    ClosurePipeline_close(pipeline);
+    pthread_join(consumer.thread, NULL);
+    const uint64_t elapsed = Benchmark_now() - start;
+    ClosurePipeline_delete(pipeline);
+
+    const intptr_t expected = (intptr_t) (values * (values - 1) / 2 + values * (stages * (stages + 1) / 2));
+    if (consumer.sum != expected) {
+        fprintf(stderr, "wrong sum: %ld, expected: %ld\n", (long) consumer.sum, (long) expected);
+        exit(EXIT_FAILURE);
+    }
+    return (double) values / ((double) elapsed / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t values = Benchmark_iterations(argc, argv, 1 << 20);
+    const size_t maxStages = (argc > 2) ? strtoul(argv[2], NULL, 10) : 4;
+
+    printf("values: %zu, ring capacity: %d, batch: %d\n", values, CAPACITY, BATCH);
+    printf("%-7s %-6s %16s\n", "mode", "stages", "values/s");
+    for (size_t stages = 1; stages <= maxStages; stages++) {
+        printf("%-7s %-6zu %16.0f\n", "single", stages, run(stages, values, false));
+        printf("%-7s %-6zu %16.0f\n", "batch", stages, run(stages, values, true));
+    }
+    return 0;
+}
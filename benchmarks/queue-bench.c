@@ -0,0 +1,194 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * ClosureQueue contention: 1 to N producer threads posting closures to a single event-loop thread that calls them,
+ * compared against a mutex-protected ring.
+ *
+ * Usage: queue-bench [closures per producer] [max producers]
+ *
+ * - mutex: producers and the consumer serialise on a mutex, waiting on conditions when the ring is full or empty.
+ * - pop: `ClosureQueue_push` and `ClosureQueue_pop`, one closure at a time.
+ * - batch: `ClosureQueue_push` and `ClosureQueue_popBatch`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <closure.h>
+#include <closure_queue.h>
+#include "benchmark.h"
+
+#define CAPACITY    1024
+#define BATCH       64
+
+enum Mode {
+    Mode_Mutex, Mode_Pop, Mode_Batch
+};
+
+static const char *const modeNames[] = {"mutex", "pop", "batch"};
+
+struct MutexQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    size_t head;
+    size_t tail;
+    struct Closure *slots[CAPACITY];
+};
+
+struct Producer {
+    pthread_t thread;
+    enum Mode mode;
+    struct MutexQueue *mutexQueue;
+    struct ClosureQueue *closureQueue;
+    struct Closure **closures;
+    size_t count;
+};
+
+static Result postedImpl(Option environment, Option arguments) {
+    (void) arguments;
+    Benchmark_use(*(const uintptr_t *) Option_unwrap(environment) * 0x9E3779B97F4A7C15u);
+    return Result_ok(NULL);
+}
+
+static const struct ClosureClass postedClass = {
+        .name="Posted",
+        .environmentSize=sizeof(uintptr_t),
+        .call=postedImpl,
+};
+
+static void MutexQueue_push(struct MutexQueue *self, struct Closure *closure) {
+    pthread_mutex_lock(&self->mutex);
+    while (self->tail - self->head == CAPACITY) {
+        pthread_cond_wait(&self->notFull, &self->mutex);
+    }
+    self->slots[self->tail++ % CAPACITY] = closure;
+    pthread_cond_signal(&self->notEmpty);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+static struct Closure *MutexQueue_pop(struct MutexQueue *self) {
+    pthread_mutex_lock(&self->mutex);
+    while (self->tail == self->head) {
+        pthread_cond_wait(&self->notEmpty, &self->mutex);
+    }
+    struct Closure *closure = self->slots[self->head++ % CAPACITY];
+    pthread_cond_signal(&self->notFull);
+    pthread_mutex_unlock(&self->mutex);
+    return closure;
+}
+
+static void *produce(void *argument) {
+    const struct Producer *producer = argument;
+    for (size_t i = 0; i < producer->count; i++) {
+        if (Mode_Mutex == producer->mode) {
+            MutexQueue_push(producer->mutexQueue, producer->closures[i]);
+        } else {
+            ClosureQueue_push(producer->closureQueue, producer->closures[i]);
+        }
+    }
+    return NULL;
+}
+
+static size_t pop(enum Mode mode, struct MutexQueue *mutexQueue, struct ClosureQueue *closureQueue,
+                  struct Closure **out) {
+    switch (mode) {
+        case Mode_Mutex:
+            out[0] = MutexQueue_pop(mutexQueue);
+            return 1;
+        case Mode_Pop:
+            out[0] = Option_unwrap(ClosureQueue_pop(closureQueue));
+            return 1;
+        default:
+            return ClosureQueue_popBatch(closureQueue, out, BATCH);
+    }
+}
+
+static double run(enum Mode mode, size_t producers, size_t count) {
+    struct MutexQueue mutexQueue = {.head=0, .tail=0};
+    pthread_mutex_init(&mutexQueue.mutex, NULL);
+    pthread_cond_init(&mutexQueue.notEmpty, NULL);
+    pthread_cond_init(&mutexQueue.notFull, NULL);
+    struct ClosureQueue *closureQueue = ClosureQueue_new(CAPACITY);
+    struct Producer *threads = calloc(producers, sizeof(threads[0]));
+    for (size_t i = 0; i < producers; i++) {
+        threads[i] = (struct Producer) {.mode=mode, .mutexQueue=&mutexQueue, .closureQueue=closureQueue, .count=count};
+        threads[i].closures = malloc(count * sizeof(threads[i].closures[0]));
+        for (size_t k = 0; k < count; k++) {
+            const uintptr_t environment = i * count + k;
+            threads[i].closures[k] = Closure_newFromClass(&postedClass, Option_some((void *) &environment));
+        }
+    }
+
+    const uint64_t start = Benchmark_now();
+    for (size_t i = 0; i < producers; i++) {
+        pthread_create(&threads[i].thread, NULL, produce, &threads[i]);
+    }
+    // the main thread is the event loop, calling and releasing the closures posted
+    struct Closure *closures[BATCH];
+    for (size_t called = 0; called < producers * count;) {
+        const size_t n = pop(mode, &mutexQueue, closureQueue, closures);
+        for (size_t i = 0; i < n; i++) {
+            Benchmark_use(Closure_call(closures[i]));
+            Closure_delete(closures[i]);
+        }
+        called += n;
+    }
+    const uint64_t elapsed = Benchmark_now() - start;
+
+    for (size_t i = 0; i < producers; i++) {
+        pthread_join(threads[i].thread, NULL);
+        free(threads[i].closures);
+    }
+    free(threads);
+    ClosureQueue_delete(closureQueue);
+    pthread_cond_destroy(&mutexQueue.notFull);
+    pthread_cond_destroy(&mutexQueue.notEmpty);
+    pthread_mutex_destroy(&mutexQueue.mutex);
+    return (double) (producers * count) / ((double) elapsed / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = Benchmark_iterations(argc, argv, 1 << 18);
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t maxProducers = (argc > 2) ? strtoul(argv[2], NULL, 10) : (size_t) (cores > 0 ? cores : 1);
+
+    printf("closures per producer: %zu, capacity: %d, batch: %d, cores: %ld\n", count, CAPACITY, BATCH, cores);
+    printf("%-6s %-9s %16s\n", "mode", "producers", "closures/s");
+    for (size_t producers = 1; producers <= maxProducers; producers *= 2) {
+        for (size_t mode = Mode_Mutex; mode <= Mode_Batch; mode++) {
+            printf("%-6s %-9zu %16.0f\n", modeNames[mode], producers, run((enum Mode) mode, producers, count));
+        }
+        if (producers < maxProducers && producers * 2 > maxProducers) {
+            producers = maxProducers / 2;   // always measure maxProducers too
+        }
+    }
+    return 0;
+}
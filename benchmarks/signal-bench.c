@@ -0,0 +1,118 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * ClosureSignal emission throughput on 1 to N emitting threads.
+ *
+ * Usage: signal-bench [emissions per thread] [max threads]
+ *
+ * - steady: the slots never change while emitting.
+ * - churn: the main thread keeps connecting and disconnecting a slot while the others emit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <closure.h>
+#include <closure_signal.h>
+#include "benchmark.h"
+
+#define SLOTS   8
+
+struct Emitter {
+    pthread_t thread;
+    struct ClosureSignal *signal;
+    size_t emissions;
+};
+
+static size_t finished = 0;
+
+static Result slotImpl(Option environment, Option arguments) {
+    const uintptr_t seed = (uintptr_t) Option_unwrap(environment) ^ (uintptr_t) Option_getOr(arguments, NULL);
+    Benchmark_use(seed * 0x9E3779B97F4A7C15u);
+    return Result_ok(NULL);
+}
+
+static void deleteImpl(Option environment) {
+    (void) environment;
+}
+
+static void *emit(void *argument) {
+    const struct Emitter *emitter = argument;
+    for (size_t i = 0; i < emitter->emissions; i++) {
+        Benchmark_use(ClosureSignal_emit(emitter->signal, Option_some((Option_Value) (uintptr_t) i)));
+    }
+    __atomic_fetch_add(&finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static double run(size_t threads, size_t emissions, bool churn) {
+    struct ClosureSignal *signal = ClosureSignal_new();
+    for (uintptr_t i = 1; i <= SLOTS; i++) {
+        ClosureSignal_connect(signal, Closure_new(Option_some((Option_Value) i), slotImpl, deleteImpl));
+    }
+    struct Emitter *emitters = calloc(threads, sizeof(emitters[0]));
+    __atomic_store_n(&finished, 0, __ATOMIC_RELAXED);
+    const uint64_t start = Benchmark_now();
+    for (size_t i = 0; i < threads; i++) {
+        emitters[i].signal = signal;
+        emitters[i].emissions = emissions;
+        pthread_create(&emitters[i].thread, NULL, emit, &emitters[i]);
+    }
+    for (uintptr_t changes = 1; churn && __atomic_load_n(&finished, __ATOMIC_ACQUIRE) < threads; changes++) {
+        struct Closure *closure = Closure_new(Option_some((Option_Value) changes), slotImpl, deleteImpl);
+        ClosureSignal_connect(signal, closure);
+        ClosureSignal_disconnect(signal, closure);
+    }
+    for (size_t i = 0; i < threads; i++) {
+        pthread_join(emitters[i].thread, NULL);
+    }
+    const uint64_t elapsed = Benchmark_now() - start;
+    free(emitters);
+    ClosureSignal_delete(signal);
+    return (double) (threads * emissions) / ((double) elapsed / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t emissions = Benchmark_iterations(argc, argv, 1 << 20);
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t maxThreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : (size_t) (cores > 0 ? cores : 1);
+
+    printf("emissions per thread: %zu, slots: %d, cores: %ld\n", emissions, SLOTS, cores);
+    printf("%-8s %-7s %16s\n", "mode", "threads", "emissions/s");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        printf("%-8s %-7zu %16.0f\n", "steady", threads, run(threads, emissions, false));
+        printf("%-8s %-7zu %16.0f\n", "churn", threads, run(threads, emissions, true));
+        if (threads < maxThreads && threads * 2 > maxThreads) {
+            threads = maxThreads / 2;   // always measure maxThreads too
+        }
+    }
+    return 0;
+}
@@ -25,29 +25,400 @@ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
 OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <assert.h>
+#include <stdint.h>
 #include "alligator.h"
 #include "alligator_config.h"
 
+#if ALLIGATOR_STATS
+
+#include <pthread.h>
+
+/*
+ * Every allocation is prefixed by this header, right before the memory returned to the caller; offset is the distance
+ * from the beginning of the underlying allocation, greater than the size of the header only for over-aligned memory.
+ */
+struct AlligatorStatsHeader {
+    size_t size;
+    size_t offset;
+};
+
+#define ALLIGATOR_STATS_HEADER_SIZE     sizeof(struct AlligatorStatsHeader)
+
+/*
+ * Every thread counts into its own table, registered in a global list so that `Alligator_stats` can sum all tables
+ * up; a table is merged into the retired one when its thread exits.
+ * Counters are written only by the owner thread, with relaxed atomic stores so that other threads can read them;
+ * live counters are signed since memory may be freed by a thread other than the one that allocated it.
+ */
+struct AlligatorStatsTable {
+    struct AlligatorStatsTable *next;
+    struct AlligatorStatsTable *previous;
+    long long liveBytes;
+    long long liveObjects;
+    size_t allocations;
+    size_t frees;
+    size_t histogram[ALLIGATOR_STATS_BUCKETS];
+    long long pendingBytes;     // live bytes not yet added to the global count
+};
+
+static pthread_once_t statsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t statsKey;
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct AlligatorStatsTable *statsTables = NULL;
+static struct AlligatorStatsTable statsRetired;
+static long long statsLiveBytes = 0;        // the global count, updated in batches
+static long long statsHighWatermark = 0;
+static __thread struct AlligatorStatsTable *statsTable = NULL;
+
+static void AlligatorStats_flush(struct AlligatorStatsTable *const self) {
+    const long long pending = self->pendingBytes;
+    self->pendingBytes = 0;
+    const long long live = __atomic_add_fetch(&statsLiveBytes, pending, __ATOMIC_RELAXED);
+    long long watermark = __atomic_load_n(&statsHighWatermark, __ATOMIC_RELAXED);
+    while (live > watermark && !__atomic_compare_exchange_n(&statsHighWatermark, &watermark, live, true,
+                                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+static void AlligatorStatsTable_add(struct AlligatorStatsTable *const self, const struct AlligatorStatsTable *const other) {
+    self->liveBytes += __atomic_load_n(&other->liveBytes, __ATOMIC_RELAXED);
+    self->liveObjects += __atomic_load_n(&other->liveObjects, __ATOMIC_RELAXED);
+    self->allocations += __atomic_load_n(&other->allocations, __ATOMIC_RELAXED);
+    self->frees += __atomic_load_n(&other->frees, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < ALLIGATOR_STATS_BUCKETS; i++) {
+        self->histogram[i] += __atomic_load_n(&other->histogram[i], __ATOMIC_RELAXED);
+    }
+}
+
+static void AlligatorStats_retire(void *const table) {
+    struct AlligatorStatsTable *self = table;
+    AlligatorStats_flush(self);
+    pthread_mutex_lock(&statsMutex);
+    if (self->previous) {
+        self->previous->next = self->next;
+    } else {
+        statsTables = self->next;
+    }
+    if (self->next) {
+        self->next->previous = self->previous;
+    }
+    AlligatorStatsTable_add(&statsRetired, self);
+    pthread_mutex_unlock(&statsMutex);
+    statsTable = NULL;      // a later destructor may still allocate, a new table is then made
+    __Alligator_free(self);
+}
+
+static void AlligatorStats_init(void) {
+    pthread_key_create(&statsKey, AlligatorStats_retire);
+}
+
+static struct AlligatorStatsTable *AlligatorStats_table(void) {
+    struct AlligatorStatsTable *self = statsTable;
+    if (NULL == self) {
+        pthread_once(&statsOnce, AlligatorStats_init);
+        self = __Alligator_calloc(1, sizeof(*self));
+        if (NULL == self) {
+            return NULL;    // out of memory: the allocation is not counted
+        }
+        pthread_mutex_lock(&statsMutex);
+        self->next = statsTables;
+        if (statsTables) {
+            statsTables->previous = self;
+        }
+        statsTables = self;
+        pthread_mutex_unlock(&statsMutex);
+        pthread_setspecific(statsKey, self);
+        statsTable = self;
+    }
+    return self;
+}
+
+static void AlligatorStats_count(const long long bytes, const long long objects, const size_t allocations,
+                                 const size_t frees) {
+    struct AlligatorStatsTable *self = AlligatorStats_table();
+    if (self) {
+        __atomic_store_n(&self->liveBytes, self->liveBytes + bytes, __ATOMIC_RELAXED);
+        __atomic_store_n(&self->liveObjects, self->liveObjects + objects, __ATOMIC_RELAXED);
+        __atomic_store_n(&self->allocations, self->allocations + allocations, __ATOMIC_RELAXED);
+        __atomic_store_n(&self->frees, self->frees + frees, __ATOMIC_RELAXED);
+        if (allocations) {
+            const size_t size = (size_t) bytes;
+            size_t bucket = (0 == size) ? 0 : (size_t) (64 - __builtin_clzll(size));
+            bucket = bucket < ALLIGATOR_STATS_BUCKETS ? bucket : ALLIGATOR_STATS_BUCKETS - 1;
+            __atomic_store_n(&self->histogram[bucket], self->histogram[bucket] + 1, __ATOMIC_RELAXED);
+        }
+        self->pendingBytes += bytes;
+        if (self->pendingBytes >= ALLIGATOR_STATS_FLUSH_BYTES || self->pendingBytes <= -ALLIGATOR_STATS_FLUSH_BYTES) {
+            AlligatorStats_flush(self);
+        }
+    }
+}
+
+/*
+ * Writes the header at the beginning of the underlying allocation base and returns the memory for the caller.
+ */
+static void *AlligatorStats_track(void *const base, const size_t size, const size_t offset) {
+    if (NULL == base) {
+        return NULL;
+    }
+    void *memory = (char *) base + offset;
+    struct AlligatorStatsHeader *header = (struct AlligatorStatsHeader *) memory - 1;
+    header->size = size;
+    header->offset = offset;
+    AlligatorStats_count((long long) size, 1, 1, 0);
+    return memory;
+}
+
+/*
+ * Returns the beginning of the underlying allocation of memory.
+ */
+static void *AlligatorStats_untrack(void *const memory) {
+    const struct AlligatorStatsHeader *header = (struct AlligatorStatsHeader *) memory - 1;
+    AlligatorStats_count(-(long long) header->size, -1, 0, 1);
+    return (char *) memory - header->offset;
+}
+
+#endif
+
+/*
+ * Every allocation made by alligator, arenas included, goes through these functions.
+ */
+#if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
+
+static void *Alligator_allocateAligned(const size_t alignment, const size_t size) {
+#if ALLIGATOR_STATS
+    const size_t offset = alignment > ALLIGATOR_STATS_HEADER_SIZE ? alignment : ALLIGATOR_STATS_HEADER_SIZE;
+    if (size > SIZE_MAX - offset) {
+        return NULL;
+    }
+    return AlligatorStats_track(__Alligator_aligned_alloc(alignment, size + offset), size, offset);
+#else
+    return __Alligator_aligned_alloc(alignment, size);
+#endif
+}
+
+#endif
+
+static void *Alligator_allocate(const size_t size) {
+#if ALLIGATOR_STATS
+    if (size > SIZE_MAX - ALLIGATOR_STATS_HEADER_SIZE) {
+        return NULL;
+    }
+    return AlligatorStats_track(__Alligator_malloc(size + ALLIGATOR_STATS_HEADER_SIZE), size,
+                                ALLIGATOR_STATS_HEADER_SIZE);
+#else
+    return __Alligator_malloc(size);
+#endif
+}
+
+static void *Alligator_allocateZeroed(const size_t numberOfMembers, const size_t memberSize) {
+#if ALLIGATOR_STATS
+    if (memberSize && numberOfMembers > (SIZE_MAX - ALLIGATOR_STATS_HEADER_SIZE) / memberSize) {
+        return NULL;
+    }
+    const size_t size = numberOfMembers * memberSize;
+    return AlligatorStats_track(__Alligator_calloc(1, size + ALLIGATOR_STATS_HEADER_SIZE), size,
+                                ALLIGATOR_STATS_HEADER_SIZE);
+#else
+    return __Alligator_calloc(numberOfMembers, memberSize);
+#endif
+}
+
+static void *Alligator_reallocate(void *const memory, const size_t newSize) {
+#if ALLIGATOR_STATS
+    if (NULL == memory) {
+        return Alligator_allocate(newSize);
+    }
+    const struct AlligatorStatsHeader header = ((struct AlligatorStatsHeader *) memory)[-1];
+    if (newSize > SIZE_MAX - header.offset) {
+        return NULL;
+    }
+    void *base = __Alligator_realloc((char *) memory - header.offset, newSize + header.offset);
+    if (NULL == base) {
+        return NULL;
+    }
+    AlligatorStats_count(-(long long) header.size, -1, 0, 1);
+    return AlligatorStats_track(base, newSize, header.offset);
+#else
+    return __Alligator_realloc(memory, newSize);
+#endif
+}
+
+static void Alligator_release(void *const memory) {
+#if ALLIGATOR_STATS
+    if (memory) {
+        __Alligator_free(AlligatorStats_untrack(memory));
+    }
+#else
+    __Alligator_free(memory);
+#endif
+}
+
 #if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
 
 Option Alligator_aligned_alloc(const size_t alignment, const size_t size) {
-    return Option_fromNullable(__Alligator_aligned_alloc(alignment, size));
+    return Option_fromNullable(Alligator_allocateAligned(alignment, size));
 }
 
 #endif
 
 Option Alligator_malloc(const size_t size) {
-    return Option_fromNullable(__Alligator_malloc(size));
+    return Option_fromNullable(Alligator_allocate(size));
 }
 
 Option Alligator_calloc(const size_t numberOfMembers, const size_t memberSize) {
-    return Option_fromNullable(__Alligator_calloc(numberOfMembers, memberSize));
+    return Option_fromNullable(Alligator_allocateZeroed(numberOfMembers, memberSize));
 }
 
 Option Alligator_realloc(void *const memory, const size_t newSize) {
-    return Option_fromNullable(__Alligator_realloc(memory, newSize));
+    return Option_fromNullable(Alligator_reallocate(memory, newSize));
 }
 
 void Alligator_free(void *const memory) {
-    __Alligator_free(memory);
+    Alligator_release(memory);
+}
+
+struct AlligatorStats Alligator_stats(void) {
+    struct AlligatorStats stats = {0};
+#if ALLIGATOR_STATS
+    struct AlligatorStatsTable sum = {0};
+    pthread_mutex_lock(&statsMutex);
+    AlligatorStatsTable_add(&sum, &statsRetired);
+    for (const struct AlligatorStatsTable *table = statsTables; table; table = table->next) {
+        AlligatorStatsTable_add(&sum, table);
+    }
+    pthread_mutex_unlock(&statsMutex);
+    const long long watermark = __atomic_load_n(&statsHighWatermark, __ATOMIC_RELAXED);
+    stats.liveBytes = sum.liveBytes > 0 ? (size_t) sum.liveBytes : 0;
+    stats.liveObjects = sum.liveObjects > 0 ? (size_t) sum.liveObjects : 0;
+    stats.allocations = sum.allocations;
+    stats.frees = sum.frees;
+    stats.highWatermark = (size_t) (watermark > sum.liveBytes ? watermark : sum.liveBytes > 0 ? sum.liveBytes : 0);
+    for (size_t i = 0; i < ALLIGATOR_STATS_BUCKETS; i++) {
+        stats.histogram[i] = sum.histogram[i];
+    }
+#endif
+    return stats;
+}
+
+/*
+ * Used only to give arena allocations the strictest fundamental alignment.
+ */
+union AlligatorArenaStorage {
+    long double _longDouble;
+    long long _longLong;
+    void *_pointer;
+    void (*_function)(void);
+};
+
+#define ALLIGATOR_ARENA_ALIGNMENT   __alignof__(union AlligatorArenaStorage)
+
+struct AlligatorArenaBlock {
+    struct AlligatorArenaBlock *next;
+    size_t capacity;
+    union AlligatorArenaStorage storage[];
+};
+
+struct AlligatorArenaCleanup {
+    struct AlligatorArenaCleanup *next;
+    AlligatorArena_CleanupFn cleanupFn;
+    void *context;
+};
+
+struct AlligatorArena {
+    struct AlligatorArenaBlock *head;
+    struct AlligatorArenaBlock *current;
+    char *cursor;
+    char *limit;
+    size_t blockSize;
+    struct AlligatorArenaCleanup *cleanups;
+};
+
+static struct AlligatorArenaBlock *AlligatorArenaBlock_new(const size_t capacity, struct AlligatorArenaBlock *const next) {
+    struct AlligatorArenaBlock *self = Alligator_allocate(sizeof(*self) + capacity);
+    if (self) {
+        self->next = next;
+        self->capacity = capacity;
+    }
+    return self;
+}
+
+static void AlligatorArena_use(struct AlligatorArena *const self, struct AlligatorArenaBlock *const block) {
+    self->current = block;
+    self->cursor = (char *) block->storage;
+    self->limit = self->cursor + block->capacity;
+}
+
+static void AlligatorArena_cleanup(struct AlligatorArena *const self) {
+    for (struct AlligatorArenaCleanup *cleanup = self->cleanups; cleanup; cleanup = cleanup->next) {
+        cleanup->cleanupFn(cleanup->context);
+    }
+    self->cleanups = NULL;
+}
+
+Option AlligatorArena_new(const size_t blockSize) {
+    struct AlligatorArena *self = Alligator_allocate(sizeof(*self));
+    if (self) {
+        self->blockSize = (blockSize + ALLIGATOR_ARENA_ALIGNMENT - 1) & ~(ALLIGATOR_ARENA_ALIGNMENT - 1);
+        self->head = AlligatorArenaBlock_new(self->blockSize, NULL);
+        self->cleanups = NULL;
+        if (NULL == self->head) {
+            Alligator_release(self);
+            return None;
+        }
+        AlligatorArena_use(self, self->head);
+    }
+    return Option_fromNullable(self);
+}
+
+Option AlligatorArena_malloc(struct AlligatorArena *const arena, size_t size) {
+    assert(arena);
+    size = (size + ALLIGATOR_ARENA_ALIGNMENT - 1) & ~(ALLIGATOR_ARENA_ALIGNMENT - 1);
+    if (size > (size_t) (arena->limit - arena->cursor)) {
+        struct AlligatorArenaBlock *next = arena->current->next;
+        if (NULL == next || next->capacity < size) {
+            // blocks kept from previous cycles that are too small are skipped, they will be reused after the next reset
+            next = AlligatorArenaBlock_new(size > arena->blockSize ? size : arena->blockSize, next);
+            if (NULL == next) {
+                return None;
+            }
+            arena->current->next = next;
+        }
+        AlligatorArena_use(arena, next);
+    }
+    void *memory = arena->cursor;
+    arena->cursor += size;
+    return Option_some(memory);
+}
+
+Option AlligatorArena_defer(struct AlligatorArena *const arena, const AlligatorArena_CleanupFn cleanupFn, void *const context) {
+    assert(arena);
+    assert(cleanupFn);
+    const Option memory = AlligatorArena_malloc(arena, sizeof(struct AlligatorArenaCleanup));
+    if (Option_isNone(memory)) {
+        return None;
+    }
+    struct AlligatorArenaCleanup *cleanup = Option_unwrap(memory);
+    cleanup->next = arena->cleanups;
+    cleanup->cleanupFn = cleanupFn;
+    cleanup->context = context;
+    arena->cleanups = cleanup;
+    return Option_some(context);
+}
+
+void AlligatorArena_reset(struct AlligatorArena *const arena) {
+    assert(arena);
+    AlligatorArena_cleanup(arena);
+    AlligatorArena_use(arena, arena->head);
+}
+
+void AlligatorArena_delete(struct AlligatorArena *const arena) {
+    if (arena) {
+        AlligatorArena_cleanup(arena);
+        for (struct AlligatorArenaBlock *block = arena->head, *next; block; block = next) {
+            next = block->next;
+            Alligator_release(block);
+        }
+        Alligator_release(arena);
+    }
 }
@@ -63,6 +63,83 @@ __attribute__((__warn_unused_result__));
 
 extern void Alligator_free(void *memory);
 
+#define ALLIGATOR_STATS_BUCKETS     32
+
+/**
+ * Allocation statistics, summed up over all threads, see `Alligator_stats`.
+ */
+struct AlligatorStats {
+    /** Bytes requested by the allocations not yet freed. */
+    size_t liveBytes;
+    /** Allocations not yet freed. */
+    size_t liveObjects;
+    /** Allocations made so far, a reallocation counts both as an allocation and as a free. */
+    size_t allocations;
+    /** Frees made so far. */
+    size_t frees;
+    /** The peak of liveBytes, see `ALLIGATOR_STATS_FLUSH_BYTES` in `alligator_config.h` for its accuracy. */
+    size_t highWatermark;
+    /** histogram[i] counts the allocations of less than 2^i bytes and at least 2^(i-1). */
+    size_t histogram[ALLIGATOR_STATS_BUCKETS];
+};
+
+/**
+ * Returns the allocation statistics, including the memory of the arenas.
+ * Counters are kept per thread and summed up on read, so that they may be slightly behind concurrent allocations.
+ * Statistics are kept only if `ALLIGATOR_STATS` is set in `alligator_config.h`, otherwise every counter is 0.
+ */
+extern struct AlligatorStats Alligator_stats(void)
+__attribute__((__warn_unused_result__));
+
+/**
+ * A region of memory where objects sharing the same lifetime are allocated by bumping a pointer and reclaimed all
+ * together, either on reset or on delete, with no need of freeing them one by one.
+ *
+ * @attention arenas are not thread-safe.
+ */
+struct AlligatorArena;
+
+/**
+ * Type signature of the callbacks to be executed when an arena is reset or deleted.
+ */
+typedef void (*AlligatorArena_CleanupFn)(void *context);
+
+/**
+ * Creates an arena that grows by blocks of at least blockSize bytes.
+ * Returns an `OptionOf(struct AlligatorArena *)` that is `None` if out of memory.
+ */
+extern Option AlligatorArena_new(size_t blockSize)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Allocates size bytes from this arena, suitably aligned for any type.
+ * The memory must not be passed to `Alligator_free`, it is reclaimed by `AlligatorArena_reset` or `AlligatorArena_delete`.
+ */
+extern Option AlligatorArena_malloc(struct AlligatorArena *arena, size_t size)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Registers a callback to be executed with context when this arena is reset or deleted, callbacks are executed in
+ * reverse order of registration.
+ * Returns an `OptionOf(void *)` wrapping context, `None` if out of memory.
+ *
+ * @attention cleanupFn must not be `NULL`.
+ */
+extern Option AlligatorArena_defer(struct AlligatorArena *arena, AlligatorArena_CleanupFn cleanupFn, void *context)
+__attribute__((__warn_unused_result__, __nonnull__(1, 2)));
+
+/**
+ * Executes the registered callbacks and reclaims all the memory allocated from this arena at once;
+ * blocks are kept to serve later allocations.
+ */
+extern void AlligatorArena_reset(struct AlligatorArena *arena)
+__attribute__((__nonnull__));
+
+/**
+ * Executes the registered callbacks and releases this arena along with all of its blocks.
+ */
+extern void AlligatorArena_delete(struct AlligatorArena *arena);
+
 #ifdef __cplusplus
 }
 #endif
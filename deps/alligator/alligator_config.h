@@ -38,6 +38,7 @@ OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include <stdlib.h>
+#include "alligator_slab.h"
 
 #if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
 
@@ -53,6 +54,69 @@ __attribute__(...)
 extern "C" {
 #endif
 
+/*
+ * Set to 1 to keep allocation statistics, reported by `Alligator_stats`: every allocation is then prefixed by a
+ * 16 bytes header recording its size. Can also be set at configure time, e.g. `cmake -DALLIGATOR_STATS=ON`.
+ */
+#ifndef ALLIGATOR_STATS
+#define ALLIGATOR_STATS                 0
+#endif
+
+/*
+ * Live bytes allocated or freed by a thread are added to the global count, used to track the high watermark, once
+ * they exceed this amount: the high watermark may then be off by this amount per thread.
+ */
+#ifndef ALLIGATOR_STATS_FLUSH_BYTES
+#define ALLIGATOR_STATS_FLUSH_BYTES     (64L * 1024L)
+#endif
+
+/*
+ * The slab backend is selected at configure time, e.g. `cmake -DALLIGATOR_BACKEND=slab`, which defines ALLIGATOR_BACKEND_SLAB.
+ */
+#if defined(ALLIGATOR_BACKEND_SLAB)
+
+/*
+ * Size of a single slab, every slab holds objects of the same size class.
+ */
+#ifndef ALLIGATOR_SLAB_PAGE_SIZE
+#define ALLIGATOR_SLAB_PAGE_SIZE        4096
+#endif
+
+/*
+ * Amount of virtual memory reserved (not committed) upfront for slabs, once exhausted requests are forwarded to the stdlib.
+ */
+#ifndef ALLIGATOR_SLAB_RESERVE_SIZE
+#define ALLIGATOR_SLAB_RESERVE_SIZE     (256UL * 1024UL * 1024UL)
+#endif
+
+/*
+ * Number of objects exchanged at once between a thread cache and the shared depot, per size class.
+ */
+#ifndef ALLIGATOR_SLAB_MAGAZINE_SIZE
+#define ALLIGATOR_SLAB_MAGAZINE_SIZE    32
+#endif
+
+#if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
+
+#define __Alligator_aligned_alloc(alignment, size) \
+    __AlligatorSlab_aligned_alloc((alignment), (size))
+
+#endif
+
+#define __Alligator_malloc(size) \
+    __AlligatorSlab_malloc((size))
+
+#define __Alligator_calloc(numberOfMembers, memberSize) \
+    __AlligatorSlab_calloc((numberOfMembers), (memberSize))
+
+#define __Alligator_realloc(memory, newSize) \
+    __AlligatorSlab_realloc((memory), (newSize))
+
+#define __Alligator_free(memory) \
+    __AlligatorSlab_free((memory))
+
+#else
+
 #if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
 
 #define __Alligator_aligned_alloc(alignment, size) \
@@ -72,6 +136,8 @@ extern "C" {
 #define __Alligator_free(memory) \
     free((memory))
 
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,414 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "alligator_config.h"
+
+#if defined(ALLIGATOR_BACKEND_SLAB)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "alligator_slab.h"
+
+#define SLAB_ALIGNMENT      16
+#define SLAB_PAGES          (ALLIGATOR_SLAB_RESERVE_SIZE / ALLIGATOR_SLAB_PAGE_SIZE)
+#define SLAB_NO_CLASS       0xFF
+
+/*
+ * Size classes, every class is a multiple of SLAB_ALIGNMENT so that every object is suitably aligned for any type.
+ */
+static const size_t SLAB_CLASSES[] = {16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256};
+
+#define SLAB_CLASSES_COUNT  (sizeof(SLAB_CLASSES) / sizeof(SLAB_CLASSES[0]))
+#define SLAB_MAX_SIZE       256
+
+struct SlabObject {
+    struct SlabObject *next;
+};
+
+struct SlabClass {
+    struct SlabObject *freeList;
+    char *cursor;   // bump pointer inside the last slab assigned to this class
+    char *limit;
+};
+
+/*
+ * A fixed-capacity stack of free objects of the same size class, owned by a thread while loaded in its cache and
+ * exchanged in whole with the depot, so that the shared state is touched once every ALLIGATOR_SLAB_MAGAZINE_SIZE operations.
+ */
+struct SlabMagazine {
+    struct SlabMagazine *next;
+    size_t count;
+    void *objects[ALLIGATOR_SLAB_MAGAZINE_SIZE];
+};
+
+/*
+ * Magazines not loaded by any thread, non-empty ones are kept apart from empty ones.
+ */
+struct SlabDepot {
+    struct SlabMagazine *full;
+    struct SlabMagazine *empty;
+};
+
+enum SlabCacheState {
+    SlabCacheState_Uninitialized, SlabCacheState_Active, SlabCacheState_Dead
+};
+
+/*
+ * Per-thread cache: every thread loads at most two magazines per size class.
+ * Objects are not owned by the thread that allocated them, so an object freed by another thread simply
+ * lands in that thread's magazines and flows back through the depot.
+ */
+struct SlabCache {
+    enum SlabCacheState state;
+    struct SlabMagazine *loaded[SLAB_CLASSES_COUNT];
+    struct SlabMagazine *previous[SLAB_CLASSES_COUNT];
+};
+
+static int slabLock = 0;
+static bool slabReady = false;
+static pthread_key_t slabCacheKey;
+static __thread struct SlabCache slabCache;
+static struct SlabDepot slabDepots[SLAB_CLASSES_COUNT];
+static char *slabRegion = NULL;
+static size_t slabPagesInUse = 0;
+static struct SlabClass slabClasses[SLAB_CLASSES_COUNT];
+static unsigned char slabPageClasses[SLAB_PAGES];   // size class of every slab in the region, by page index
+
+/*
+ * Maps (size + SLAB_ALIGNMENT - 1) / SLAB_ALIGNMENT to the index of the smallest size class able to hold size bytes.
+ */
+static const unsigned char slabLookup[SLAB_MAX_SIZE / SLAB_ALIGNMENT + 1] = {
+        0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11
+};
+
+static void Slab_flushCache(void *cache);
+
+static void Slab_initialize(void) {
+    memset(slabPageClasses, SLAB_NO_CLASS, sizeof(slabPageClasses));
+    void *region = mmap(NULL, ALLIGATOR_SLAB_RESERVE_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == region || 0 != pthread_key_create(&slabCacheKey, Slab_flushCache)) {
+        if (MAP_FAILED != region) {
+            munmap(region, ALLIGATOR_SLAB_RESERVE_SIZE);
+        }
+        region = NULL;  // if we cannot reserve, everything goes to the stdlib
+    }
+    slabRegion = region;
+}
+
+static inline void Slab_lock(void) {
+    while (__atomic_exchange_n(&slabLock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&slabLock, __ATOMIC_RELAXED)) {
+            sched_yield();
+        }
+    }
+}
+
+static inline void Slab_unlock(void) {
+    __atomic_store_n(&slabLock, 0, __ATOMIC_RELEASE);
+}
+
+static inline bool Slab_owns(const void *const memory) {
+    return NULL != slabRegion && (uintptr_t) memory - (uintptr_t) slabRegion < ALLIGATOR_SLAB_RESERVE_SIZE;
+}
+
+static inline size_t Slab_classOf(const void *const memory) {
+    return slabPageClasses[((uintptr_t) memory - (uintptr_t) slabRegion) / ALLIGATOR_SLAB_PAGE_SIZE];
+}
+
+/*
+ * Must be called holding slabLock.
+ */
+static void *Slab_allocate(const size_t class) {
+    struct SlabClass *const slabClass = &slabClasses[class];
+    struct SlabObject *object = slabClass->freeList;
+    if (object) {
+        slabClass->freeList = object->next;
+        return object;
+    }
+    if (slabClass->cursor + SLAB_CLASSES[class] > slabClass->limit) {
+        if (slabPagesInUse >= SLAB_PAGES) {
+            return NULL;
+        }
+        slabPageClasses[slabPagesInUse] = (unsigned char) class;
+        slabClass->cursor = slabRegion + slabPagesInUse * ALLIGATOR_SLAB_PAGE_SIZE;
+        slabClass->limit = slabClass->cursor + ALLIGATOR_SLAB_PAGE_SIZE;
+        slabPagesInUse++;
+    }
+    void *memory = slabClass->cursor;
+    slabClass->cursor += SLAB_CLASSES[class];
+    return memory;
+}
+
+/*
+ * Must be called holding slabLock.
+ */
+static void Slab_release(void *const memory, const size_t class) {
+    struct SlabClass *const slabClass = &slabClasses[class];
+    struct SlabObject *const object = memory;
+    object->next = slabClass->freeList;
+    slabClass->freeList = object;
+}
+
+/*
+ * Must be called holding slabLock.
+ */
+static void SlabDepot_push(struct SlabDepot *const depot, struct SlabMagazine *const magazine) {
+    struct SlabMagazine **list = magazine->count > 0 ? &depot->full : &depot->empty;
+    magazine->next = *list;
+    *list = magazine;
+}
+
+/*
+ * Must be called holding slabLock.
+ */
+static struct SlabMagazine *SlabDepot_pop(struct SlabDepot *const depot, const bool full) {
+    struct SlabMagazine **list = full ? &depot->full : &depot->empty;
+    struct SlabMagazine *magazine = *list;
+    if (magazine) {
+        *list = magazine->next;
+    }
+    return magazine;
+}
+
+static struct SlabMagazine *SlabMagazine_new(void) {
+    struct SlabMagazine *self = malloc(sizeof(*self));
+    if (self) {
+        self->next = NULL;
+        self->count = 0;
+    }
+    return self;
+}
+
+/*
+ * Initializes the cache of the calling thread, returns false if the thread cache cannot be used.
+ * Must be called holding slabLock.
+ */
+static bool SlabCache_initialize(struct SlabCache *const cache) {
+    if (SlabCacheState_Uninitialized != cache->state) {
+        return SlabCacheState_Active == cache->state;
+    }
+    for (size_t class = 0; class < SLAB_CLASSES_COUNT; class++) {
+        struct SlabMagazine *loaded = SlabDepot_pop(&slabDepots[class], false);
+        struct SlabMagazine *previous = SlabDepot_pop(&slabDepots[class], false);
+        cache->loaded[class] = loaded ? loaded : SlabMagazine_new();
+        cache->previous[class] = previous ? previous : SlabMagazine_new();
+        if (NULL == cache->loaded[class] || NULL == cache->previous[class]) {
+            free(cache->loaded[class]);
+            free(cache->previous[class]);
+            for (size_t i = 0; i < class; i++) {
+                SlabDepot_push(&slabDepots[i], cache->loaded[i]);
+                SlabDepot_push(&slabDepots[i], cache->previous[i]);
+            }
+            return false;
+        }
+    }
+    pthread_setspecific(slabCacheKey, cache);   // ensures that Slab_flushCache is called on thread exit
+    cache->state = SlabCacheState_Active;
+    return true;
+}
+
+/*
+ * Returns the magazines of an exiting thread to the depot, later requests by this thread bypass the cache.
+ */
+void Slab_flushCache(void *const cache) {
+    struct SlabCache *const self = cache;
+    Slab_lock();
+    for (size_t class = 0; class < SLAB_CLASSES_COUNT; class++) {
+        SlabDepot_push(&slabDepots[class], self->loaded[class]);
+        SlabDepot_push(&slabDepots[class], self->previous[class]);
+    }
+    self->state = SlabCacheState_Dead;
+    Slab_unlock();
+}
+
+/*
+ * Refills the cache when both of its magazines are empty, by either exchanging the previous magazine for a full one
+ * from the depot or filling it directly from the slabs. Returns false if out of memory.
+ */
+static bool SlabCache_refill(struct SlabCache *const cache, const size_t class) {
+    struct SlabMagazine *empty = cache->previous[class];
+    Slab_lock();
+    struct SlabMagazine *full = SlabDepot_pop(&slabDepots[class], true);
+    if (full) {
+        SlabDepot_push(&slabDepots[class], empty);
+    } else {
+        for (full = empty; full->count < ALLIGATOR_SLAB_MAGAZINE_SIZE; full->count++) {
+            if (NULL == (full->objects[full->count] = Slab_allocate(class))) {
+                break;
+            }
+        }
+    }
+    Slab_unlock();
+    cache->previous[class] = cache->loaded[class];
+    cache->loaded[class] = full;
+    return full->count > 0;
+}
+
+/*
+ * Makes room in the cache when both of its magazines are full, by exchanging the previous magazine for an empty one.
+ */
+static void SlabCache_drain(struct SlabCache *const cache, const size_t class) {
+    struct SlabMagazine *full = cache->previous[class];
+    Slab_lock();
+    struct SlabMagazine *empty = SlabDepot_pop(&slabDepots[class], false);
+    if (empty || (empty = SlabMagazine_new())) {
+        SlabDepot_push(&slabDepots[class], full);
+    } else {
+        // out of memory for a new magazine: give the previous magazine's objects back to the slabs
+        while (full->count > 0) {
+            Slab_release(full->objects[--full->count], class);
+        }
+        empty = full;
+    }
+    Slab_unlock();
+    cache->previous[class] = cache->loaded[class];
+    cache->loaded[class] = empty;
+}
+
+static void *SlabCache_allocate(struct SlabCache *const cache, const size_t class) {
+    struct SlabMagazine *loaded = cache->loaded[class];
+    if (loaded->count == 0) {
+        if (cache->previous[class]->count > 0) {
+            cache->loaded[class] = cache->previous[class];
+            cache->previous[class] = loaded;
+        } else if (!SlabCache_refill(cache, class)) {
+            return NULL;
+        }
+        loaded = cache->loaded[class];
+    }
+    return loaded->objects[--loaded->count];
+}
+
+static void SlabCache_release(struct SlabCache *const cache, void *const memory, const size_t class) {
+    struct SlabMagazine *loaded = cache->loaded[class];
+    if (loaded->count == ALLIGATOR_SLAB_MAGAZINE_SIZE) {
+        if (cache->previous[class]->count < ALLIGATOR_SLAB_MAGAZINE_SIZE) {
+            cache->loaded[class] = cache->previous[class];
+            cache->previous[class] = loaded;
+        } else {
+            SlabCache_drain(cache, class);
+        }
+        loaded = cache->loaded[class];
+    }
+    loaded->objects[loaded->count++] = memory;
+}
+
+/*
+ * Slow path of the allocation: initializes the slabs and the thread cache if needed.
+ */
+static void *Slab_allocateSlow(struct SlabCache *const cache, const size_t class) {
+    void *memory = NULL;
+    Slab_lock();
+    if (!slabReady) {
+        Slab_initialize();
+        slabReady = true;
+    }
+    if (NULL != slabRegion) {
+        const bool cached = SlabCache_initialize(cache);
+        if (!cached) {
+            memory = Slab_allocate(class);
+        }
+        Slab_unlock();
+        return cached ? SlabCache_allocate(cache, class) : memory;
+    }
+    Slab_unlock();
+    return memory;
+}
+
+#if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
+
+void *__AlligatorSlab_aligned_alloc(const size_t alignment, const size_t size) {
+    return (alignment <= SLAB_ALIGNMENT) ? __AlligatorSlab_malloc(size) : aligned_alloc(alignment, size);
+}
+
+#endif
+
+void *__AlligatorSlab_malloc(const size_t size) {
+    if (size > SLAB_MAX_SIZE) {
+        return malloc(size);
+    }
+    struct SlabCache *const cache = &slabCache;
+    const size_t class = slabLookup[(size + SLAB_ALIGNMENT - 1) / SLAB_ALIGNMENT];
+    void *memory = (SlabCacheState_Active == cache->state)
+                   ? SlabCache_allocate(cache, class)
+                   : Slab_allocateSlow(cache, class);
+    return memory ? memory : malloc(size);
+}
+
+void *__AlligatorSlab_calloc(const size_t numberOfMembers, const size_t memberSize) {
+    if (0 != memberSize && numberOfMembers > SLAB_MAX_SIZE / memberSize) {
+        return calloc(numberOfMembers, memberSize);
+    }
+    void *memory = __AlligatorSlab_malloc(numberOfMembers * memberSize);
+    if (memory) {
+        memset(memory, 0, numberOfMembers * memberSize);
+    }
+    return memory;
+}
+
+void *__AlligatorSlab_realloc(void *const memory, const size_t newSize) {
+    if (!Slab_owns(memory)) {
+        return (NULL == memory) ? __AlligatorSlab_malloc(newSize) : realloc(memory, newSize);
+    }
+    const size_t oldSize = SLAB_CLASSES[Slab_classOf(memory)];
+    if (newSize <= oldSize) {
+        return memory;
+    }
+    void *newMemory = __AlligatorSlab_malloc(newSize);
+    if (newMemory) {
+        memcpy(newMemory, memory, oldSize);
+        __AlligatorSlab_free(memory);
+    }
+    return newMemory;
+}
+
+void __AlligatorSlab_free(void *const memory) {
+    if (Slab_owns(memory)) {
+        struct SlabCache *const cache = &slabCache;
+        if (SlabCacheState_Active == cache->state) {
+            SlabCache_release(cache, memory, Slab_classOf(memory));
+        } else {
+            Slab_lock();
+            if (!SlabCache_initialize(cache)) {
+                Slab_release(memory, Slab_classOf(memory));
+                Slab_unlock();
+                return;
+            }
+            Slab_unlock();
+            SlabCache_release(cache, memory, Slab_classOf(memory));
+        }
+    } else {
+        free(memory);
+    }
+}
+
+#endif
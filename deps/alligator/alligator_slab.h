@@ -0,0 +1,73 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Size-class slab allocator.
+ *
+ * Small requests are served from page-sized slabs carved out of a single reserved region of virtual memory,
+ * each slab holding objects of one size class only; freed objects are kept on per-class free lists and never
+ * returned to the system. Requests that do not fit any size class are forwarded to the stdlib allocator.
+ * Every thread caches free objects in magazines, exchanged in batches with a shared depot, so that the common
+ * allocation and deallocation paths do not touch any shared state.
+ *
+ * WARNING:
+ *  This is one of the backends selectable through alligator_config.h, DO NOT INCLUDE THIS FILE directly in your code.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L) || (defined(__cplusplus) && __cplusplus >= 201103L)
+
+extern void *__AlligatorSlab_aligned_alloc(size_t alignment, size_t size)
+__attribute__((__warn_unused_result__));
+
+#endif
+
+extern void *__AlligatorSlab_malloc(size_t size)
+__attribute__((__warn_unused_result__));
+
+extern void *__AlligatorSlab_calloc(size_t numberOfMembers, size_t memberSize)
+__attribute__((__warn_unused_result__));
+
+extern void *__AlligatorSlab_realloc(void *memory, size_t newSize)
+__attribute__((__warn_unused_result__));
+
+extern void __AlligatorSlab_free(void *memory);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,7 +1,24 @@
 set(ARCHIVE_NAME alligator)
 message("${ARCHIVE_NAME}@${CMAKE_CURRENT_LIST_DIR} using: ${CMAKE_CURRENT_LIST_FILE}")
 
+set(ALLIGATOR_BACKEND "libc" CACHE STRING "The allocator used by alligator: libc or slab")
+set_property(CACHE ALLIGATOR_BACKEND PROPERTY STRINGS libc slab)
+option(ALLIGATOR_STATS "Keep allocation statistics, reported by Alligator_stats" OFF)
+
 file(GLOB ARCHIVE_HEADERS ${CMAKE_CURRENT_LIST_DIR}/*.h)
 file(GLOB ARCHIVE_SOURCES ${CMAKE_CURRENT_LIST_DIR}/*.c)
+find_package(Threads REQUIRED)
+
 add_library(${ARCHIVE_NAME} ${ARCHIVE_HEADERS} ${ARCHIVE_SOURCES})
 target_link_libraries(${ARCHIVE_NAME} PUBLIC option)
+target_link_libraries(${ARCHIVE_NAME} PRIVATE Threads::Threads)
+
+if (ALLIGATOR_STATS)
+    target_compile_definitions(${ARCHIVE_NAME} PRIVATE ALLIGATOR_STATS=1)
+endif ()
+
+if (ALLIGATOR_BACKEND STREQUAL "slab")
+    target_compile_definitions(${ARCHIVE_NAME} PUBLIC ALLIGATOR_BACKEND_SLAB)
+elseif (NOT ALLIGATOR_BACKEND STREQUAL "libc")
+    message(FATAL_ERROR "Unknown ALLIGATOR_BACKEND: ${ALLIGATOR_BACKEND}")
+endif ()
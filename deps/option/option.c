@@ -28,6 +28,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include <assert.h>
 #include <stddef.h>
 #include <panic/panic.h>
+
+#define OPTION_NO_INLINE
 #include "option.h"
 
 const OptionView NoneView = {.__value=NULL, .__variant=OptionVariant_None};
@@ -157,11 +159,17 @@ Option_Value __Option_unwrap(const char *const file, const int line, const Optio
     assert(NULL != file);
     assert(line > 0);
     if (Option_isNone(self)) {
-        __Panic_terminate(file, line, "%s", "Unable to unwrap value");
+        __Option_unwrapFailed(file, line);
     }
     return self.__value;
 }
 
+void __Option_unwrapFailed(const char *const file, const int line) {
+    assert(NULL != file);
+    assert(line > 0);
+    __Panic_terminate(file, line, "%s", "Unable to unwrap value");
+}
+
 Option_Value __Option_expect(const char *const file, const int line, const Option self, const char *const format, ...) {
     assert(NULL != file);
     assert(line > 0);
@@ -27,6 +27,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
 
+#include <assert.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #if !(defined(__GNUC__) || defined(__clang__))
@@ -305,6 +307,76 @@ __attribute__((__nonnull__(1)));
 extern Option_Value __Option_expect(const char *file, int line, Option self, const char *format, ...)
 __attribute__((__nonnull__(1, 4), __format__(__printf__, 4, 5)));
 
+/**
+ * @attention this function must be treated as opaque therefore must not be called directly.
+ */
+extern void __Option_unwrapFailed(const char *file, int line)
+__attribute__((__nonnull__(1), __noreturn__, __cold__));
+
+/*
+ * Inline fast paths.
+ *
+ * The most frequently used functions are also defined inline here and shadowed by macros, so that callers do not pay
+ * an out-of-line call for each of them; the exported functions are still available, e.g. `(Option_some)(value)`
+ * or through pointers, and are used everywhere if OPTION_NO_INLINE is defined before including this file.
+ */
+#ifndef OPTION_NO_INLINE
+
+static inline Option __Option_someInline(const Option_Value value) {
+    const Option self = {value, OptionVariant_Some};
+    return self;
+}
+
+static inline Option __Option_fromNullableInline(const Option_Value value) {
+    const Option self = {value, NULL == value ? OptionVariant_None : OptionVariant_Some};
+    return self;
+}
+
+static inline bool __Option_isNoneInline(const Option self) {
+    return OptionVariant_None == self.__variant;
+}
+
+static inline bool __Option_isSomeInline(const Option self) {
+    return OptionVariant_Some == self.__variant;
+}
+
+static inline Option_Value __Option_unwrapInline(const char *const file, const int line, const Option self) {
+    if (__builtin_expect(OptionVariant_None == self.__variant, 0)) {
+        __Option_unwrapFailed(file, line);
+    }
+    return self.__value;
+}
+
+static inline Option __Option_mapInline(const Option self, Option (*const f)(Option_Value)) {
+    assert(NULL != f);
+    return OptionVariant_None == self.__variant ? self : f(self.__value);
+}
+
+static inline Option __Option_altInline(const Option self, const Option a) {
+    return OptionVariant_None == self.__variant ? a : self;
+}
+
+static inline Option __Option_chainInline(const Option self, Option (*const f)(Option_Value)) {
+    assert(NULL != f);
+    return OptionVariant_None == self.__variant ? self : f(self.__value);
+}
+
+static inline Option_Value __Option_getOrInline(const Option self, const Option_Value defaultValue) {
+    return OptionVariant_None == self.__variant ? defaultValue : self.__value;
+}
+
+#define Option_some(value)                  __Option_someInline((value))
+#define Option_fromNullable(value)          __Option_fromNullableInline((value))
+#define Option_isNone(self)                 __Option_isNoneInline((self))
+#define Option_isSome(self)                 __Option_isSomeInline((self))
+#define Option_map(self, f)                 __Option_mapInline((self), (f))
+#define Option_alt(self, a)                 __Option_altInline((self), (a))
+#define Option_chain(self, f)               __Option_chainInline((self), (f))
+#define Option_getOr(self, defaultValue)    __Option_getOrInline((self), (defaultValue))
+#define __Option_unwrap(file, line, self)   __Option_unwrapInline((file), (line), (self))
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
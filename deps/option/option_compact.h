@@ -0,0 +1,206 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "option.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A compact representation of `Option` that fits in a single machine word, thus passed and returned in one register.
+ * The absence of a value is encoded as a reserved sentinel pointer, `COMPACT_OPTION_SENTINEL`, that can never be
+ * wrapped, while `NULL` is still a legit value of an `OptionVariant_Some`.
+ *
+ * @attention this struct must be treated as opaque therefore its members must not be accessed directly.
+ */
+typedef struct {
+    Option_Value __value;
+} CompactOption;
+
+/* CompactOption must fit in a single pointer (C99 compile-time check: the array size is negative otherwise). */
+typedef char __CompactOption_fitsInAPointer[sizeof(CompactOption) == sizeof(Option_Value) ? 1 : -1];
+
+/**
+ * An helper macro used for type hinting, useful when writing interfaces.
+ * By convention the annotated type is the wrapped value type.
+ */
+#define CompactOptionOf(type) \
+    CompactOption
+
+/**
+ * The reserved pointer used to represent the absence of a value, the address of the last byte of the address space.
+ */
+#define COMPACT_OPTION_SENTINEL \
+    ((Option_Value) UINTPTR_MAX)
+
+/**
+ * The `CompactNone` instance used to represent the absence of a value.
+ */
+#define CompactNone \
+    ((CompactOption) {.__value=COMPACT_OPTION_SENTINEL})
+
+/**
+ * Creates a `CompactOption` wrapping a value.
+ *
+ * @attention value must not be `COMPACT_OPTION_SENTINEL`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline CompactOption CompactOption_some(const Option_Value value) {
+    assert(COMPACT_OPTION_SENTINEL != value);
+    const CompactOption self = {value};
+    return self;
+}
+
+/**
+ * Creates a `CompactOption` wrapping a value.
+ * If value is `NULL` returns an `OptionVariant_None` else returns an `OptionVariant_Some`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline CompactOption CompactOption_fromNullable(const Option_Value value) {
+    return NULL == value ? CompactNone : CompactOption_some(value);
+}
+
+/**
+ * Creates a `CompactOption` from an `Option`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline CompactOption CompactOption_fromOption(const Option option) {
+    return Option_isNone(option) ? CompactNone : CompactOption_some(Option_unwrap(option));
+}
+
+/**
+ * Creates an `Option` from this `CompactOption`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline Option CompactOption_toOption(const CompactOption self) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? None : Option_some(self.__value);
+}
+
+/**
+ * Returns `true` if this `CompactOption` is an `OptionVariant_None`, `false` otherwise.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline bool CompactOption_isNone(const CompactOption self) {
+    return COMPACT_OPTION_SENTINEL == self.__value;
+}
+
+/**
+ * Returns `true` if this `CompactOption` is an `OptionVariant_Some`, `false` otherwise.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline bool CompactOption_isSome(const CompactOption self) {
+    return COMPACT_OPTION_SENTINEL != self.__value;
+}
+
+/**
+ * If this `CompactOption` is an `OptionVariant_Some`, apply `f` on this value else return an `OptionVariant_None`.
+ *
+ * @attention f must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))
+static inline CompactOption CompactOption_map(const CompactOption self, CompactOption (*const f)(Option_Value)) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? self : f(self.__value);
+}
+
+/**
+ * If this `CompactOption` is an `OptionVariant_Some` then it will be returned, if it is an `OptionVariant_None` the next `CompactOption` will be returned.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline CompactOption CompactOption_alt(const CompactOption self, const CompactOption a) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? a : self;
+}
+
+/**
+ * Chains several possibly failing computations.
+ *
+ * @attention f must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))
+static inline CompactOption CompactOption_chain(const CompactOption self, CompactOption (*const f)(Option_Value)) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? self : f(self.__value);
+}
+
+/**
+ * Applies a function to each case in this `CompactOption`.
+ *
+ * @attention whenNone must not be `NULL`.
+ * @attention whenSome must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2, 3)))
+static inline Option_Value CompactOption_fold(const CompactOption self, Option_Value (*const whenNone)(void),
+                                              Option_Value (*const whenSome)(Option_Value)) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? whenNone() : whenSome(self.__value);
+}
+
+/**
+ * Returns the value from this `CompactOption` if it's an `OptionVariant_Some` or a default value if this is an `OptionVariant_None`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline Option_Value CompactOption_getOr(const CompactOption self, const Option_Value defaultValue) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? defaultValue : self.__value;
+}
+
+/**
+ * Returns the value from this `CompactOption` if it's an `OptionVariant_Some` or compute a value if this is an `OptionVariant_None`.
+ *
+ * @attention f must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))
+static inline Option_Value CompactOption_getOrElse(const CompactOption self, Option_Value (*const f)(void)) {
+    return COMPACT_OPTION_SENTINEL == self.__value ? f() : self.__value;
+}
+
+/**
+ * Unwraps the value of this `CompactOption` if it's an `OptionVariant_Some` or panics if this is an `OptionVariant_None`.
+ */
+#define CompactOption_unwrap(self) \
+    __CompactOption_unwrap((__FILE__), (__LINE__), (self))
+
+/**
+ * @attention this function must be treated as opaque therefore must not be called directly.
+ */
+__attribute__((__unused__, __nonnull__(1)))
+static inline Option_Value __CompactOption_unwrap(const char *const file, const int line, const CompactOption self) {
+    if (__builtin_expect(COMPACT_OPTION_SENTINEL == self.__value, 0)) {
+        __Option_unwrapFailed(file, line);
+    }
+    return self.__value;
+}
+
+#ifdef __cplusplus
+}
+#endif
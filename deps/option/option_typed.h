@@ -0,0 +1,148 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "option.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Defines a monomorphic option type, named Name, holding a value of type Type inline, without boxing it.
+ * Type may be any scalar or small struct that can be passed and returned by value.
+ *
+ * The generated API mirrors the one of `Option`, every function is `static inline`, e.g. after
+ * `OPTION_DEFINE_TYPED(OptionPoint, struct Point)` there are `OptionPoint_some`, `OptionPoint_map` and so on:
+ *
+ * @code
+ * Name        Name_some(Type value);
+ * Name        Name_none(void);
+ * bool        Name_isSome(Name self);
+ * bool        Name_isNone(Name self);
+ * Name        Name_map(Name self, Name f(Type));
+ * Name        Name_alt(Name self, Name a);
+ * Name        Name_chain(Name self, Name f(Type));
+ * Type        Name_fold(Name self, Type whenNone(void), Type whenSome(Type));
+ * Type        Name_getOr(Name self, Type defaultValue);
+ * Type        Name_getOrElse(Name self, Type f(void));
+ * Type        OptionTyped_unwrap(Name, Name self);    // panics if self is none
+ * @endcode
+ */
+#define OPTION_DEFINE_TYPED(Name, Type)                                                                                \
+    typedef struct {                                                                                                   \
+        Type __value;                                                                                                  \
+        enum OptionVariant __variant;                                                                                  \
+    } Name;                                                                                                            \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Name Name##_some(Type value) {                                                                       \
+        const Name self = {value, OptionVariant_Some};                                                                 \
+        return self;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Name Name##_none(void) {                                                                             \
+        const Name self = {.__variant=OptionVariant_None};                                                             \
+        return self;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline bool Name##_isSome(const Name self) {                                                                \
+        return OptionVariant_Some == self.__variant;                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline bool Name##_isNone(const Name self) {                                                                \
+        return OptionVariant_None == self.__variant;                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))                                                \
+    static inline Name Name##_map(const Name self, Name (*const f)(Type)) {                                            \
+        return OptionVariant_Some == self.__variant ? f(self.__value) : self;                                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Name Name##_alt(const Name self, const Name a) {                                                     \
+        return OptionVariant_Some == self.__variant ? self : a;                                                        \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))                                                \
+    static inline Name Name##_chain(const Name self, Name (*const f)(Type)) {                                          \
+        return OptionVariant_Some == self.__variant ? f(self.__value) : self;                                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2, 3)))                                             \
+    static inline Type Name##_fold(const Name self, Type (*const whenNone)(void), Type (*const whenSome)(Type)) {      \
+        return OptionVariant_Some == self.__variant ? whenSome(self.__value) : whenNone();                             \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Type Name##_getOr(const Name self, Type defaultValue) {                                              \
+        return OptionVariant_Some == self.__variant ? self.__value : defaultValue;                                     \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))                                                \
+    static inline Type Name##_getOrElse(const Name self, Type (*const f)(void)) {                                      \
+        return OptionVariant_Some == self.__variant ? self.__value : f();                                              \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__unused__, __nonnull__(1)))                                                                        \
+    static inline Type __##Name##_unwrap(const char *const file, const int line, const Name self) {                    \
+        if (__builtin_expect(OptionVariant_Some != self.__variant, 0)) {                                               \
+            __Option_unwrapFailed(file, line);                                                                         \
+        }                                                                                                              \
+        return self.__value;                                                                                           \
+    }
+
+/**
+ * Unwraps the value of self, an option of type Name, if it's an `OptionVariant_Some` or panics if it's an `OptionVariant_None`.
+ */
+#define OptionTyped_unwrap(Name, self) \
+    __##Name##_unwrap((__FILE__), (__LINE__), (self))
+
+/*
+ * Built-in typed options
+ */
+OPTION_DEFINE_TYPED(OptionInt, int)
+
+OPTION_DEFINE_TYPED(OptionLong, long)
+
+OPTION_DEFINE_TYPED(OptionSize, size_t)
+
+OPTION_DEFINE_TYPED(OptionDouble, double)
+
+#ifdef __cplusplus
+}
+#endif
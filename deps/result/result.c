@@ -30,7 +30,10 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <panic/panic.h>
+
+#define RESULT_NO_INLINE
 #include "result.h"
+#include "result_compact.h"
 
 ResultView ResultView_error(Error error) {
     assert(NULL != error);
@@ -175,11 +178,24 @@ Result_Value __Result_unwrap(const char *const file, const int line, const Resul
     assert(NULL != file);
     assert(line > 0);
     if (Result_isError(self)) {
-        __Panic_terminate(file, line, "%s", self.__error->__message);
+        __Result_unwrapFailed(file, line, self.__error);
     }
     return self.__value;
 }
 
+void __Result_unwrapFailed(const char *const file, const int line, const Error error) {
+    assert(NULL != file);
+    assert(line > 0);
+    assert(NULL != error);
+    __Panic_terminate(file, line, "%s", error->__message);
+}
+
+void __CompactResult_okFailed(const char *const file, const int line, const Result_Value value) {
+    assert(NULL != file);
+    assert(line > 0);
+    __Panic_terminate(file, line, "CompactResult can't wrap %p: the lowest bit is reserved to errors", value);
+}
+
 Result_Value __Result_expect(const char *const file, const int line, const Result self, const char *const format, ...) {
     assert(NULL != file);
     assert(line > 0);
@@ -27,6 +27,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
 
+#include <assert.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <error/error.h>
 
@@ -316,6 +318,83 @@ __attribute__((__nonnull__(1)));
 extern Result_Value __Result_expect(const char *file, int line, Result self, const char *format, ...)
 __attribute__((__nonnull__(1, 4), __format__(__printf__, 4, 5)));
 
+/**
+ * @attention this function must be treated as opaque therefore must not be called directly.
+ */
+extern void __Result_unwrapFailed(const char *file, int line, Error error)
+__attribute__((__nonnull__, __noreturn__, __cold__));
+
+/*
+ * Inline fast paths.
+ *
+ * The most frequently used functions are also defined inline here and shadowed by macros, so that callers do not pay
+ * an out-of-line call for each of them; the exported functions are still available, e.g. `(Result_ok)(value)`
+ * or through pointers, and are used everywhere if RESULT_NO_INLINE is defined before including this file.
+ */
+#ifndef RESULT_NO_INLINE
+
+static inline Result __Result_errorInline(const Error error) {
+    assert(NULL != error);
+    assert(Ok != error);
+    const Result self = {error, NULL};
+    return self;
+}
+
+static inline Result __Result_okInline(const Result_Value value) {
+    const Result self = {Ok, value};
+    return self;
+}
+
+static inline bool __Result_isErrorInline(const Result self) {
+    return Ok != self.__error;
+}
+
+static inline bool __Result_isOkInline(const Result self) {
+    return Ok == self.__error;
+}
+
+static inline Result_Value __Result_unwrapInline(const char *const file, const int line, const Result self) {
+    if (__builtin_expect(Ok != self.__error, 0)) {
+        __Result_unwrapFailed(file, line, self.__error);
+    }
+    return self.__value;
+}
+
+static inline Result __Result_mapInline(const Result self, Result (*const f)(Result_Value)) {
+    assert(NULL != f);
+    return Ok != self.__error ? self : f(self.__value);
+}
+
+static inline Result __Result_altInline(const Result self, const Result a) {
+    return Ok != self.__error ? a : self;
+}
+
+static inline Result __Result_chainInline(const Result self, Result (*const f)(Result_Value)) {
+    assert(NULL != f);
+    return Ok != self.__error ? self : f(self.__value);
+}
+
+static inline Result_Value __Result_getOrInline(const Result self, const Result_Value defaultValue) {
+    return Ok != self.__error ? defaultValue : self.__value;
+}
+
+static inline Error __Result_inspectInline(const Result self) {
+    return self.__error;
+}
+
+#define Result_error(error)                 __Result_errorInline((error))
+#define Result_ok(value)                    __Result_okInline((value))
+#define Result_isError(self)                __Result_isErrorInline((self))
+#define Result_isOk(self)                   __Result_isOkInline((self))
+#define Result_map(self, f)                 __Result_mapInline((self), (f))
+#define Result_alt(self, a)                 __Result_altInline((self), (a))
+#define Result_chain(self, f)               __Result_chainInline((self), (f))
+#define Result_getOr(self, defaultValue)    __Result_getOrInline((self), (defaultValue))
+#define Result_inspect(self)                __Result_inspectInline((self))
+#define __Result_unwrap(file, line, self)   __Result_unwrapInline((file), (line), (self))
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
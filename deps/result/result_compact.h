@@ -0,0 +1,248 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <error/error.h>
+#include "result.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A compact representation of `Result` that fits in a single machine word, thus returned in one register.
+ * Errors are static singletons aligned at least as a pointer, so an `Error` variant is stored as the address of the
+ * error with the lowest bit set, while an `Ok` variant is stored as the value itself.
+ * As a consequence wrapped values must have the lowest bit clear: Ok values must be `NULL`, even integers or pointers
+ * at least 2-byte aligned; never store `char *`, strings and byte buffers commonly start at odd addresses.
+ * `CompactResult_ok` checks it in every build and panics on odd values, which would otherwise be read as errors.
+ *
+ * @attention this struct must be treated as opaque therefore its members must not be accessed directly.
+ */
+typedef struct {
+    uintptr_t __word;
+} CompactResult;
+
+/* CompactResult must fit in a single pointer (C99 compile-time check: the array size is negative otherwise). */
+typedef char __CompactResult_fitsInAPointer[sizeof(CompactResult) == sizeof(Result_Value) ? 1 : -1];
+
+/**
+ * An helper macro used for type hinting, useful when writing interfaces.
+ * By convention the annotated type is the wrapped value type and the following are the `Error` types that may be returned.
+ */
+#define CompactResultOf(type, errors...) \
+    CompactResult
+
+/**
+ * The bit used to tag `Error` variants.
+ */
+#define COMPACT_RESULT_ERROR_TAG \
+    ((uintptr_t) 1)
+
+/**
+ * Creates a `CompactResult` variant wrapping an `Error`.
+ *
+ * @attention error must not be Ok.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__))
+static inline CompactResult CompactResult_error(const Error error) {
+    assert(NULL != error);
+    assert(Ok != error);
+    assert(0 == ((uintptr_t) error & COMPACT_RESULT_ERROR_TAG));
+    const CompactResult self = {(uintptr_t) error | COMPACT_RESULT_ERROR_TAG};
+    return self;
+}
+
+/**
+ * Creates a `CompactResult` variant wrapping a value or panics if value has the lowest bit set.
+ *
+ * @attention value must have the lowest bit clear, i.e. it must not be a `char *`.
+ */
+#define CompactResult_ok(value) \
+    __CompactResult_ok((__FILE__), (__LINE__), (value))
+
+/**
+ * @attention this function must be treated as opaque therefore must not be called directly.
+ */
+extern void __CompactResult_okFailed(const char *file, int line, Result_Value value)
+__attribute__((__nonnull__(1), __noreturn__, __cold__));
+
+/**
+ * @attention this function must be treated as opaque therefore must not be called directly.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(1)))
+static inline CompactResult __CompactResult_ok(const char *const file, const int line, const Result_Value value) {
+    if (__builtin_expect(0 != ((uintptr_t) value & COMPACT_RESULT_ERROR_TAG), 0)) {
+        __CompactResult_okFailed(file, line, value);
+    }
+    const CompactResult self = {(uintptr_t) value};
+    return self;
+}
+
+/**
+ * Returns `true` if this `CompactResult` is wrapping an `Error`, `false` otherwise.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline bool CompactResult_isError(const CompactResult self) {
+    return 0 != (self.__word & COMPACT_RESULT_ERROR_TAG);
+}
+
+/**
+ * Returns `true` if this `CompactResult` is wrapping a value, `false` otherwise.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline bool CompactResult_isOk(const CompactResult self) {
+    return 0 == (self.__word & COMPACT_RESULT_ERROR_TAG);
+}
+
+/**
+ * Returns the error associated to this `CompactResult`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline Error CompactResult_inspect(const CompactResult self) {
+    return CompactResult_isError(self) ? (Error) (self.__word & ~COMPACT_RESULT_ERROR_TAG) : Ok;
+}
+
+/**
+ * Returns the explanations of the error associated to this `CompactResult`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline const char *CompactResult_explain(const CompactResult self) {
+    return Error_explain(CompactResult_inspect(self));
+}
+
+/**
+ * Creates a `CompactResult` from a `Result`.
+ *
+ * @attention the value of result, if any, must have the lowest bit clear.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline CompactResult CompactResult_fromResult(const Result result) {
+    return Result_isOk(result) ? CompactResult_ok(Result_unwrap(result)) : CompactResult_error(Result_inspect(result));
+}
+
+/**
+ * Creates a `Result` from this `CompactResult`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline Result CompactResult_toResult(const CompactResult self) {
+    return CompactResult_isOk(self) ? Result_ok((Result_Value) self.__word) : Result_error(CompactResult_inspect(self));
+}
+
+/**
+ * If this `CompactResult` is an `Ok` variant, apply `f` on this value else return this.
+ *
+ * @attention f must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))
+static inline CompactResult CompactResult_map(const CompactResult self, CompactResult (*const f)(Result_Value)) {
+    return CompactResult_isError(self) ? self : f((Result_Value) self.__word);
+}
+
+/**
+ * If this `CompactResult` is an `Ok` variant then this will be returned, if it is an `Error` variant the next `CompactResult` will be returned.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline CompactResult CompactResult_alt(const CompactResult self, const CompactResult a) {
+    return CompactResult_isError(self) ? a : self;
+}
+
+/**
+ * Chains several possibly failing computations.
+ *
+ * @attention f must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))
+static inline CompactResult CompactResult_chain(const CompactResult self, CompactResult (*const f)(Result_Value)) {
+    return CompactResult_isError(self) ? self : f((Result_Value) self.__word);
+}
+
+/**
+ * Applies a function to each case in this `CompactResult`.
+ *
+ * @attention whenError must not be `NULL`.
+ * @attention whenOk must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2, 3)))
+static inline Result_Value CompactResult_fold(const CompactResult self, Result_Value (*const whenError)(Error),
+                                              Result_Value (*const whenOk)(Result_Value)) {
+    return CompactResult_isError(self) ? whenError(CompactResult_inspect(self)) : whenOk((Result_Value) self.__word);
+}
+
+/**
+ * Returns the value from this `CompactResult` if it's an `Ok` variant or a default value if this is an `Error`.
+ */
+__attribute__((__warn_unused_result__, __unused__))
+static inline Result_Value CompactResult_getOr(const CompactResult self, const Result_Value defaultValue) {
+    return CompactResult_isError(self) ? defaultValue : (Result_Value) self.__word;
+}
+
+/**
+ * Returns the value from this `CompactResult` if it's an `Ok` variant or compute a value if this is an `Error`.
+ *
+ * @attention f must not be `NULL`.
+ */
+__attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))
+static inline Result_Value CompactResult_getOrElse(const CompactResult self, Result_Value (*const f)(void)) {
+    return CompactResult_isError(self) ? f() : (Result_Value) self.__word;
+}
+
+/**
+ * Unwraps the value of this `CompactResult` if it's an `Ok` variant or panics if this is an `Error` variant.
+ */
+#define CompactResult_unwrap(self) \
+    __CompactResult_unwrap((__FILE__), (__LINE__), (self))
+
+/**
+ * Unwraps the value of this `CompactResult` if it's an `Ok` variant or panics if this is an `Error` variant with a custom message.
+ */
+#define CompactResult_expect(self, ...) \
+    __Result_expect((__FILE__), (__LINE__), CompactResult_toResult((self)), __VA_ARGS__)
+
+/**
+ * @attention this function must be treated as opaque therefore must not be called directly.
+ */
+__attribute__((__unused__, __nonnull__(1)))
+static inline Result_Value __CompactResult_unwrap(const char *const file, const int line, const CompactResult self) {
+    if (__builtin_expect(CompactResult_isError(self), 0)) {
+        __Result_unwrapFailed(file, line, CompactResult_inspect(self));
+    }
+    return (Result_Value) self.__word;
+}
+
+#ifdef __cplusplus
+}
+#endif
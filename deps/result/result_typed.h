@@ -0,0 +1,164 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "result.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Defines a monomorphic result type, named Name, holding either an `Error` or a value of type Type inline, without
+ * boxing it. Type may be any scalar or small struct that can be passed and returned by value.
+ *
+ * The generated API mirrors the one of `Result`, every function is `static inline`, e.g. after
+ * `RESULT_DEFINE_TYPED(ResultPoint, struct Point)` there are `ResultPoint_ok`, `ResultPoint_map` and so on:
+ *
+ * @code
+ * Name        Name_ok(Type value);
+ * Name        Name_error(Error error);
+ * bool        Name_isOk(Name self);
+ * bool        Name_isError(Name self);
+ * Name        Name_map(Name self, Name f(Type));
+ * Name        Name_alt(Name self, Name a);
+ * Name        Name_chain(Name self, Name f(Type));
+ * Type        Name_fold(Name self, Type whenError(Error), Type whenOk(Type));
+ * Type        Name_getOr(Name self, Type defaultValue);
+ * Type        Name_getOrElse(Name self, Type f(void));
+ * Error       Name_inspect(Name self);
+ * const char *Name_explain(Name self);
+ * Type        ResultTyped_unwrap(Name, Name self);    // panics if self is an error
+ * @endcode
+ *
+ * Closures can return typed results through `Closure_callAs`.
+ */
+#define RESULT_DEFINE_TYPED(Name, Type)                                                                                \
+    typedef struct {                                                                                                   \
+        Error __error;                                                                                                 \
+        Type __value;                                                                                                  \
+    } Name;                                                                                                            \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Name Name##_ok(Type value) {                                                                         \
+        const Name self = {Ok, value};                                                                                 \
+        return self;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__))                                                   \
+    static inline Name Name##_error(const Error error) {                                                               \
+        assert(NULL != error);                                                                                         \
+        assert(Ok != error);                                                                                           \
+        const Name self = {.__error=error};                                                                            \
+        return self;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline bool Name##_isOk(const Name self) {                                                                  \
+        return Ok == self.__error;                                                                                     \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline bool Name##_isError(const Name self) {                                                               \
+        return Ok != self.__error;                                                                                     \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))                                                \
+    static inline Name Name##_map(const Name self, Name (*const f)(Type)) {                                            \
+        return Ok == self.__error ? f(self.__value) : self;                                                            \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Name Name##_alt(const Name self, const Name a) {                                                     \
+        return Ok == self.__error ? self : a;                                                                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))                                                \
+    static inline Name Name##_chain(const Name self, Name (*const f)(Type)) {                                          \
+        return Ok == self.__error ? f(self.__value) : self;                                                            \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2, 3)))                                             \
+    static inline Type Name##_fold(const Name self, Type (*const whenError)(Error), Type (*const whenOk)(Type)) {      \
+        return Ok == self.__error ? whenOk(self.__value) : whenError(self.__error);                                    \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Type Name##_getOr(const Name self, Type defaultValue) {                                              \
+        return Ok == self.__error ? self.__value : defaultValue;                                                       \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__, __nonnull__(2)))                                                \
+    static inline Type Name##_getOrElse(const Name self, Type (*const f)(void)) {                                      \
+        return Ok == self.__error ? self.__value : f();                                                                \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline Error Name##_inspect(const Name self) {                                                              \
+        return self.__error;                                                                                           \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__warn_unused_result__, __unused__))                                                                \
+    static inline const char *Name##_explain(const Name self) {                                                        \
+        return Error_explain(self.__error);                                                                            \
+    }                                                                                                                  \
+                                                                                                                       \
+    __attribute__((__unused__, __nonnull__(1)))                                                                        \
+    static inline Type __##Name##_unwrap(const char *const file, const int line, const Name self) {                    \
+        if (__builtin_expect(Ok != self.__error, 0)) {                                                                 \
+            __Result_unwrapFailed(file, line, self.__error);                                                           \
+        }                                                                                                              \
+        return self.__value;                                                                                           \
+    }
+
+/**
+ * Unwraps the value of self, a result of type Name, if it's an `Ok` variant or panics if it's an `Error` variant.
+ */
+#define ResultTyped_unwrap(Name, self) \
+    __##Name##_unwrap((__FILE__), (__LINE__), (self))
+
+/*
+ * Built-in typed results
+ */
+RESULT_DEFINE_TYPED(ResultInt, int)
+
+RESULT_DEFINE_TYPED(ResultLong, long)
+
+RESULT_DEFINE_TYPED(ResultSize, size_t)
+
+RESULT_DEFINE_TYPED(ResultDouble, double)
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,14 +29,11 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "adder.h"
 
 int main() {
-    struct AdderResult *result;
+    int sum;
     struct AdderClosure *add5 = AdderClosure_new(5);
 
-    printf("%d\n", AdderResult_get(result = Result_unwrap(AdderClosure_call(add5, 8))));
-    AdderResult_delete(result);
-
-    printf("%d\n", AdderResult_get(result = Result_unwrap(AdderClosure_call(add5, 6))));
-    AdderResult_delete(result);
+    printf("%d\n", *(int *) Result_unwrap(AdderClosure_callInto(add5, 8, &sum)));
+    printf("%d\n", *(int *) Result_unwrap(AdderClosure_callInto(add5, 6, &sum)));
 
     AdderClosure_delete(add5);
     return 0;
@@ -26,7 +26,6 @@ OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include <assert.h>
-#include <memory.h>
 #include <closure.h>
 #include <alligator/alligator.h>
 #include "adder.h"
@@ -38,10 +37,6 @@ struct AdderEnvironment {
     const int x;
 };
 
-static struct AdderEnvironment *AdderEnvironment_new(int x);
-
-static void AdderEnvironment_delete(struct AdderEnvironment *self);
-
 /*
  * AdderArguments
  */
@@ -63,32 +58,29 @@ static struct AdderResult *AdderResult_new(int value);
 
 /*
  * AdderClosure
+ *
+ * `struct AdderClosure` is never defined: it is an opaque handle to the underlying `struct Closure` that keeps
+ * its `AdderEnvironment` inline, so that creating an adder costs a single allocation.
  */
-struct AdderClosure {
-    struct Closure *closure;
-};
-
 static Result AdderClosure_callImpl(Option environment, Option arguments);
 
-static void AdderClosure_deleteImpl(Option environment);
+static void AdderClosure_callBatchImpl(Option environment, const Option *arguments, Result *out, size_t n);
 
-/*
- * IMPLEMENTATION
- */
+static Result AdderClosure_callIntoImpl(Option environment, Option arguments, void *output, size_t outputSize);
+
+static const struct ClosureClass AdderClosure_class = {
+        .name="AdderClosure",
+        .environmentSize=sizeof(struct AdderEnvironment),
+        .call=AdderClosure_callImpl,
+        .delete=NULL,   // the environment owns no resources
+        .callBatch=AdderClosure_callBatchImpl,
+        .clone=NULL,
+        .callInto=AdderClosure_callIntoImpl,
+};
 
 /*
- * AdderEnvironment
+ * IMPLEMENTATION
  */
-struct AdderEnvironment *AdderEnvironment_new(int x) {
-    struct AdderEnvironment *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
-    struct AdderEnvironment init = {.x=x};
-    memcpy(self, &init, sizeof(*self));
-    return self;
-}
-
-void AdderEnvironment_delete(struct AdderEnvironment *self) {
-    Alligator_free(self);
-}
 
 /*
  * AdderResult
@@ -112,23 +104,42 @@ void AdderResult_delete(struct AdderResult *self) {
  * AdderClosure
  */
 struct AdderClosure *AdderClosure_new(int x) {
-    struct AdderEnvironment *environment = AdderEnvironment_new(x);
-    struct Closure *closure = Closure_new(Option_some(environment), AdderClosure_callImpl, AdderClosure_deleteImpl);
-    struct AdderClosure *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
-    self->closure = closure;
-    return self;
+    const struct AdderEnvironment environment = {.x=x};
+    return (struct AdderClosure *) Closure_newFromClass(&AdderClosure_class, Option_some((void *) &environment));
 }
 
 ResultOf(struct AdderResult *, OutOfMemory) AdderClosure_call(struct AdderClosure *self, int y) {
     assert(self);
-    return Closure_callWith(self->closure, AdderArguments_bake(y));
+    return Closure_callWith((struct Closure *) self, AdderArguments_bake(y));
 }
 
-void AdderClosure_delete(struct AdderClosure *self) {
-    if (self) {
-        Closure_delete(self->closure);
+ResultOf(int *, DomainError) AdderClosure_callInto(struct AdderClosure *self, int y, int *out) {
+    assert(self);
+    assert(out);
+    return Closure_callInto((struct Closure *) self, AdderArguments_bake(y), out, sizeof(*out));
+}
+
+void AdderClosure_callBatch(struct AdderClosure *self, const int *ys, Result *out, size_t n) {
+    assert(self);
+    assert(ys);
+    assert(out);
+    enum {
+        CHUNK = 64
+    };
+    struct AdderArguments arguments[CHUNK];
+    Option options[CHUNK];
+    for (size_t offset = 0; offset < n; offset += CHUNK) {
+        const size_t count = (n - offset) < CHUNK ? (n - offset) : CHUNK;
+        for (size_t i = 0; i < count; i++) {
+            arguments[i].y = ys[offset + i];
+            options[i] = Option_some(&arguments[i]);
+        }
+        Closure_callBatch((struct Closure *) self, options, out + offset, count);
     }
-    Alligator_free(self);
+}
+
+void AdderClosure_delete(struct AdderClosure *self) {
+    Closure_delete((struct Closure *) self);
 }
 
 Result AdderClosure_callImpl(Option environment, Option arguments) {
@@ -139,8 +150,25 @@ Result AdderClosure_callImpl(Option environment, Option arguments) {
     return Result_ok(AdderResult_new(adderEnvironment->x + adderArguments->y));
 }
 
-void AdderClosure_deleteImpl(Option environment) {
-    if (Option_isSome(environment)) {
-        AdderEnvironment_delete(Option_unwrap(environment));
+void AdderClosure_callBatchImpl(Option environment, const Option *arguments, Result *out, size_t n) {
+    assert(Option_isSome(environment));
+    const int x = ((struct AdderEnvironment *) Option_unwrap(environment))->x;
+    for (size_t i = 0; i < n; i++) {
+        assert(Option_isSome(arguments[i]));
+        const struct AdderArguments *adderArguments = Option_unwrap(arguments[i]);
+        out[i] = Result_ok(AdderResult_new(x + adderArguments->y));
+    }
+}
+
+Result AdderClosure_callIntoImpl(Option environment, Option arguments, void *output, size_t outputSize) {
+    assert(Option_isSome(environment));
+    assert(Option_isSome(arguments));
+    assert(output);
+    if (outputSize < sizeof(int)) {
+        return Result_error(DomainError);
     }
+    struct AdderEnvironment *adderEnvironment = Option_unwrap(environment);
+    struct AdderArguments *adderArguments = Option_unwrap(arguments);
+    *(int *) output = adderEnvironment->x + adderArguments->y;
+    return Result_ok(output);
 }
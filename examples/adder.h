@@ -27,6 +27,7 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
 
+#include <stddef.h>
 #include <result/result.h>
 
 #if !(defined(__GNUC__) || defined(__clang__))
@@ -55,6 +56,10 @@ extern struct AdderClosure *AdderClosure_new(int x);
 
 extern ResultOf(struct AdderResult *) AdderClosure_call(struct AdderClosure *self, int y);
 
+extern ResultOf(int *) AdderClosure_callInto(struct AdderClosure *self, int y, int *out);
+
+extern void AdderClosure_callBatch(struct AdderClosure *self, const int *ys, Result *out, size_t n);
+
 extern void AdderClosure_delete(struct AdderClosure *self);
 
 #ifdef __cplusplus
@@ -3,6 +3,14 @@ message("${ARCHIVE_NAME}@${CMAKE_CURRENT_LIST_DIR} using: ${CMAKE_CURRENT_LIST_F
 
 file(GLOB ARCHIVE_HEADERS ${CMAKE_CURRENT_LIST_DIR}/*.h)
 file(GLOB ARCHIVE_SOURCES ${CMAKE_CURRENT_LIST_DIR}/*.c)
+find_package(Threads REQUIRED)
+
+option(CLOSURE_INSTRUMENTATION "Record per class call counts and latencies, enabled at runtime" OFF)
+
 add_library(${ARCHIVE_NAME} ${ARCHIVE_HEADERS} ${ARCHIVE_SOURCES})
-target_link_libraries(${ARCHIVE_NAME} PRIVATE alligator)
+target_link_libraries(${ARCHIVE_NAME} PRIVATE alligator panic Threads::Threads)
 target_link_libraries(${ARCHIVE_NAME} PUBLIC option result)
+
+if (CLOSURE_INSTRUMENTATION)
+    target_compile_definitions(${ARCHIVE_NAME} PUBLIC CLOSURE_INSTRUMENTATION)
+endif ()
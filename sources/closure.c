@@ -26,44 +26,391 @@ OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <panic/panic.h>
 #include <alligator/alligator.h>
 #include "closure.h"
+#include "closure_instrumentation.h"
+
+/*
+ * Used only to give the inline environment storage the strictest fundamental alignment.
+ */
+union ClosureStorage {
+    long double _longDouble;
+    long long _longLong;
+    void *_pointer;
+    void (*_function)(void);
+};
+
+/*
+ * Closure flags
+ */
+#define CLOSURE_FLAG_ARENA      0x1u    // memory is owned by an arena
+#define CLOSURE_FLAG_INLINE     0x2u    // the environment is stored inline, right after the closure
+#define CLOSURE_FLAG_NONE       0x4u    // the environment is None
+#define CLOSURE_FLAG_DELETED    0x8u    // deleteFn has already been called, used by arena closures only
 
 struct Closure {
-    Closure_CallFn call;
-    Closure_DeleteFn delete;
-    Option environment;
+    const struct ClosureClass *class;
+    void *environment;
+    unsigned references;        // accessed atomically except by the NonAtomic functions
+    unsigned flags;
 };
 
+/*
+ * Header of closures with an inline environment: the size of the environment is kept in the prefix of the storage,
+ * which is padding anyway on most ABIs, so that closures without an inline environment don't pay for it.
+ */
+struct ClosureInline {
+    struct Closure closure;
+    size_t environmentSize;
+};
+
+/*
+ * Offset of the inline environment storage from the beginning of the closure.
+ */
+#define CLOSURE_STORAGE_OFFSET \
+    ((sizeof(struct ClosureInline) + __alignof__(union ClosureStorage) - 1) / __alignof__(union ClosureStorage) * \
+     __alignof__(union ClosureStorage))
+
+/*
+ * Classes made up by the constructors taking bare function pointers are interned, so that every closure made out of
+ * the same functions shares the same class; interned classes are never released.
+ * Interned classes have no environmentSize, inline closures keep the size of their own environment instead, so that
+ * capturing environments of varying sizes doesn't make up new classes.
+ */
+#define CLOSURE_CLASSES_CAPACITY    1024    // must be a power of 2
+
+static const struct ClosureClass *closureClasses[CLOSURE_CLASSES_CAPACITY];
+
+static __thread const struct ClosureClass *closureClassesCache = NULL;     // the last class interned by this thread
+
+static const struct ClosureClass *ClosureClass_intern(const struct ClosureClass *prototype);
+
+static struct Closure *Closure_init(struct Closure *self, const struct ClosureClass *class, Option environment,
+                                    size_t environmentSize, unsigned flags);
+
+static Option Closure_environment(const struct Closure *self);
+
+static void Closure_arenaCleanup(void *closure);
+
+static void Closure_destroy(struct Closure *self);
+
+/*
+ * IMPLEMENTATION
+ */
+
+/*
+ * ClosureClass
+ */
+static bool ClosureClass_equals(const struct ClosureClass *const a, const struct ClosureClass *const b) {
+    return a->name == b->name && a->call == b->call &&
+           a->delete == b->delete && a->callBatch == b->callBatch && a->clone == b->clone &&
+           a->callInto == b->callInto;
+}
+
+static size_t ClosureClass_hash(const struct ClosureClass *const self) {
+    uint64_t hash = (uintptr_t) self->call;
+    hash = (hash ^ (uintptr_t) self->delete) * 0x9E3779B97F4A7C15u;
+    hash = (hash ^ (uintptr_t) self->callBatch) * 0x9E3779B97F4A7C15u;
+    hash = (hash ^ (uintptr_t) self->clone) * 0x9E3779B97F4A7C15u;
+    hash = (hash ^ (uintptr_t) self->callInto) * 0x9E3779B97F4A7C15u;
+    hash = (hash ^ (uintptr_t) self->name) * 0x9E3779B97F4A7C15u;
+    return (size_t) (hash >> 32u);
+}
+
+const struct ClosureClass *ClosureClass_intern(const struct ClosureClass *const prototype) {
+    assert(0 == prototype->environmentSize);
+    const struct ClosureClass *cached = closureClassesCache;
+    if (cached && ClosureClass_equals(cached, prototype)) {
+        return cached;
+    }
+    struct ClosureClass *candidate = NULL;
+    const size_t hash = ClosureClass_hash(prototype);
+    for (size_t probe = 0; probe < CLOSURE_CLASSES_CAPACITY; probe++) {
+        const struct ClosureClass **slot = &closureClasses[(hash + probe) & (CLOSURE_CLASSES_CAPACITY - 1)];
+        const struct ClosureClass *class = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+        if (NULL == class) {
+            if (NULL == candidate) {
+                candidate = Option_unwrap(Alligator_malloc(sizeof(*candidate)));
+                *candidate = *prototype;
+            }
+            if (__atomic_compare_exchange_n(slot, &class, candidate, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return closureClassesCache = candidate;
+            }
+        }
+        if (ClosureClass_equals(class, prototype)) {
+            Alligator_free(candidate);
+            return closureClassesCache = class;
+        }
+    }
+    Panic_terminate("Too many distinct closure classes, at most %d are supported\n", CLOSURE_CLASSES_CAPACITY);
+}
+
+/*
+ * Closure
+ */
+struct Closure *Closure_init(struct Closure *const self, const struct ClosureClass *const class,
+                             const Option environment, const size_t environmentSize, const unsigned flags) {
+    self->class = class;
+    self->environment = Option_isSome(environment) ? Option_unwrap(environment) : NULL;
+    self->references = 1;
+    self->flags = flags | (Option_isNone(environment) ? CLOSURE_FLAG_NONE : 0);
+    if (flags & CLOSURE_FLAG_INLINE) {
+        ((struct ClosureInline *) self)->environmentSize = environmentSize;
+    } else {
+        assert(0 == environmentSize);
+    }
+    return self;
+}
+
+Option Closure_environment(const struct Closure *const self) {
+    return (self->flags & CLOSURE_FLAG_NONE) ? None : Option_some(self->environment);
+}
+
 struct Closure *Closure_new(Option environment, Closure_CallFn callFn, Closure_DeleteFn deleteFn) {
     assert(callFn);
     assert(deleteFn);
+    const struct ClosureClass prototype = {.call=callFn, .delete=deleteFn};
     struct Closure *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
-    self->call = callFn;
-    self->delete = deleteFn;
-    self->environment = environment;
+    return Closure_init(self, ClosureClass_intern(&prototype), environment, 0, 0);
+}
+
+struct Closure *Closure_newWithEnvironmentSize(const size_t environmentSize, Closure_CallFn callFn, Closure_DeleteFn deleteFn) {
+    assert(callFn);
+    assert(deleteFn);
+    const struct ClosureClass prototype = {.call=callFn, .delete=deleteFn};
+    struct Closure *self = Option_unwrap(Alligator_malloc(CLOSURE_STORAGE_OFFSET + environmentSize));
+    return Closure_init(self, ClosureClass_intern(&prototype), Option_some((char *) self + CLOSURE_STORAGE_OFFSET),
+                        environmentSize, CLOSURE_FLAG_INLINE);
+}
+
+struct Closure *Closure_newInArena(struct AlligatorArena *const arena, const size_t environmentSize,
+                                   Closure_CallFn callFn, Closure_DeleteFn deleteFn) {
+    assert(arena);
+    assert(callFn);
+    const struct ClosureClass prototype = {.call=callFn, .delete=deleteFn};
+    struct Closure *self = Option_unwrap(AlligatorArena_malloc(arena, CLOSURE_STORAGE_OFFSET + environmentSize));
+    Closure_init(self, ClosureClass_intern(&prototype), Option_some((char *) self + CLOSURE_STORAGE_OFFSET),
+                 environmentSize, CLOSURE_FLAG_INLINE | CLOSURE_FLAG_ARENA);
+    if (deleteFn) {
+        (void) Option_unwrap(AlligatorArena_defer(arena, Closure_arenaCleanup, self));
+    }
     return self;
 }
 
+struct Closure *Closure_newFromClass(const struct ClosureClass *const class, Option environment) {
+    assert(class);
+    assert(class->call);
+    if (0 == class->environmentSize) {
+        struct Closure *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+        return Closure_init(self, class, environment, 0, 0);
+    }
+    struct Closure *self = Option_unwrap(Alligator_malloc(CLOSURE_STORAGE_OFFSET + class->environmentSize));
+    void *storage = (char *) self + CLOSURE_STORAGE_OFFSET;
+    if (Option_isSome(environment)) {
+        memcpy(storage, Option_unwrap(environment), class->environmentSize);
+    }
+    return Closure_init(self, class, Option_some(storage), class->environmentSize, CLOSURE_FLAG_INLINE);
+}
+
+Option Closure_clone(struct Closure *const closure) {
+    assert(closure);
+    assert(closure->class);
+    const struct ClosureClass *class = closure->class;
+    const Option environment = Closure_environment(closure);
+    if (closure->flags & CLOSURE_FLAG_INLINE) {
+        if (NULL == class->clone && NULL != class->delete) {
+            return None;    // the environment owns resources: a bitwise copy would release them twice
+        }
+        const size_t environmentSize = ((const struct ClosureInline *) closure)->environmentSize;
+        struct Closure *self = Option_unwrap(Alligator_malloc(CLOSURE_STORAGE_OFFSET + environmentSize));
+        const Option storage = Option_some((char *) self + CLOSURE_STORAGE_OFFSET);
+        if (class->clone) {
+            if (Option_isNone(class->clone(environment, storage))) {
+                Alligator_free(self);
+                return None;
+            }
+        } else {
+            memcpy(Option_unwrap(storage), Option_unwrap(environment), environmentSize);
+        }
+        return Option_some(Closure_init(self, class, storage, environmentSize, CLOSURE_FLAG_INLINE));
+    }
+    Option cloned = None;
+    if (class->clone) {
+        cloned = class->clone(environment, None);
+        if (Option_isNone(cloned)) {
+            return None;
+        }
+    } else if (Option_isSome(environment)) {
+        return None;    // the environment can't be shared safely without knowing how to clone it
+    }
+    struct Closure *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+    return Option_some(Closure_init(self, class, cloned, 0, 0));
+}
+
+const struct ClosureClass *Closure_getClass(const struct Closure *const closure) {
+    assert(closure);
+    return closure->class;
+}
+
+Option Closure_getEnvironment(struct Closure *const closure) {
+    assert(closure);
+    return Closure_environment(closure);
+}
+
 Result Closure_call(struct Closure *const closure) {
     assert(closure);
-    assert(closure->call);
-    assert(closure->delete);
+    assert(closure->class);
+    assert(closure->class->call);
     return Closure_callWith(closure, None);
 }
 
 Result Closure_callWith(struct Closure *const closure, Option arguments) {
     assert(closure);
-    assert(closure->call);
-    assert(closure->delete);
-    return closure->call(closure->environment, arguments);
+    assert(closure->class);
+    assert(closure->class->call);
+#if defined(CLOSURE_INSTRUMENTATION)
+    if (__ClosureInstrumentation_isEnabled()) {
+        const uint64_t start = __ClosureInstrumentation_now();
+        const Result result = closure->class->call(Closure_environment(closure), arguments);
+        __ClosureInstrumentation_record(closure->class, 1, Result_isError(result),
+                                        __ClosureInstrumentation_now() - start);
+        return result;
+    }
+#endif
+    return closure->class->call(Closure_environment(closure), arguments);
 }
 
-void Closure_delete(struct Closure *closure) {
+Result Closure_callInto(struct Closure *const closure, Option arguments, void *const output, const size_t outputSize) {
+    assert(closure);
+    assert(closure->class);
+    assert(output);
+    const Closure_CallIntoFn callIntoFn = closure->class->callInto;
+    if (NULL == callIntoFn) {
+        return Result_error(IllegalState);
+    }
+#if defined(CLOSURE_INSTRUMENTATION)
+    if (__ClosureInstrumentation_isEnabled()) {
+        const uint64_t start = __ClosureInstrumentation_now();
+        const Result result = callIntoFn(Closure_environment(closure), arguments, output, outputSize);
+        __ClosureInstrumentation_record(closure->class, 1, Result_isError(result),
+                                        __ClosureInstrumentation_now() - start);
+        return result;
+    }
+#endif
+    return callIntoFn(Closure_environment(closure), arguments, output, outputSize);
+}
+
+void Closure_setCallInto(struct Closure *const closure, Closure_CallIntoFn callIntoFn) {
+    assert(closure);
+    assert(closure->class);
+    struct ClosureClass prototype = *closure->class;
+    prototype.environmentSize = 0;
+    prototype.callInto = callIntoFn;
+    closure->class = ClosureClass_intern(&prototype);
+}
+
+void Closure_setCallBatch(struct Closure *const closure, Closure_CallBatchFn callBatchFn) {
+    assert(closure);
+    assert(closure->class);
+    struct ClosureClass prototype = *closure->class;
+    prototype.environmentSize = 0;
+    prototype.callBatch = callBatchFn;
+    closure->class = ClosureClass_intern(&prototype);
+}
+
+void Closure_callBatch(struct Closure *const closure, const Option *const arguments, Result *const out, const size_t n) {
+    assert(closure);
+    assert(closure->class);
+    assert(closure->class->call);
+    assert(arguments);
+    assert(out);
+    const struct ClosureClass *class = closure->class;
+    const Option environment = Closure_environment(closure);
+#if defined(CLOSURE_INSTRUMENTATION)
+    const bool instrumented = n > 0 && __ClosureInstrumentation_isEnabled();
+    const uint64_t start = instrumented ? __ClosureInstrumentation_now() : 0;
+#endif
+    if (class->callBatch) {
+        class->callBatch(environment, arguments, out, n);
+    } else {
+        const Closure_CallFn callFn = class->call;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = callFn(environment, arguments[i]);
+        }
+    }
+#if defined(CLOSURE_INSTRUMENTATION)
+    if (instrumented) {
+        const uint64_t elapsed = __ClosureInstrumentation_now() - start;
+        uint64_t errors = 0;
+        for (size_t i = 0; i < n; i++) {
+            errors += Result_isError(out[i]);
+        }
+        __ClosureInstrumentation_record(class, n, errors, elapsed);
+    }
+#endif
+}
+
+struct Closure *Closure_retain(struct Closure *const closure) {
+    assert(closure);
+    assert(__atomic_load_n(&closure->references, __ATOMIC_RELAXED) > 0);
+    // a new reference can only be made from an existing one, so there is nothing to synchronize with
+    __atomic_fetch_add(&closure->references, 1, __ATOMIC_RELAXED);
+    return closure;
+}
+
+void Closure_release(struct Closure *const closure) {
+    if (closure) {
+        assert(closure->class);
+        // the sole owner skips the read-modify-write: nobody else may retain the closure meanwhile
+        if (1 == __atomic_load_n(&closure->references, __ATOMIC_ACQUIRE) ||
+            1 == __atomic_fetch_sub(&closure->references, 1, __ATOMIC_ACQ_REL)) {
+            Closure_destroy(closure);
+        }
+    }
+}
+
+struct Closure *Closure_retainNonAtomic(struct Closure *const closure) {
+    assert(closure);
+    assert(closure->references > 0);
+    closure->references += 1;
+    return closure;
+}
+
+void Closure_releaseNonAtomic(struct Closure *const closure) {
     if (closure) {
-        assert(closure->call);
-        assert(closure->delete);
-        closure->delete(closure->environment);
-        Alligator_free(closure);
+        assert(closure->class);
+        assert(closure->references > 0);
+        if (0 == --closure->references) {
+            Closure_destroy(closure);
+        }
+    }
+}
+
+void Closure_delete(struct Closure *closure) {
+    Closure_release(closure);
+}
+
+void Closure_destroy(struct Closure *const self) {
+    if (self->flags & CLOSURE_FLAG_ARENA) {
+        Closure_arenaCleanup(self);
+    } else {
+        if (self->class->delete) {
+            self->class->delete(Closure_environment(self));
+        }
+        Alligator_free(self);
+    }
+}
+
+void Closure_arenaCleanup(void *const closure) {
+    struct Closure *self = closure;
+    if (!(self->flags & CLOSURE_FLAG_DELETED)) {
+        self->flags |= CLOSURE_FLAG_DELETED;    // so that deleteFn is not called again on arena reset
+        if (self->class->delete) {
+            self->class->delete(Closure_environment(self));
+        }
     }
 }
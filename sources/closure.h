@@ -27,8 +27,10 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
 
+#include <stddef.h>
 #include <option/option.h>
 #include <result/result.h>
+#include <result/result_typed.h>
 
 #if !(defined(__GNUC__) || defined(__clang__))
 __attribute__(...)
@@ -48,17 +50,186 @@ extern "C" {
 typedef Result (*Closure_CallFn)(Option, Option);
 typedef void (*Closure_DeleteFn)(Option);
 
+/**
+ * Applies the closure, given its environment, to each one of the n arguments storing the n results in out.
+ */
+typedef void (*Closure_CallBatchFn)(Option, const Option *, Result *, size_t);
+
+/**
+ * Like `Closure_CallFn` but the value is written in place, to the outputSize bytes pointed by output, rather than
+ * wrapped in the returned `Result`, that is expected to be ok with output itself or an error.
+ */
+typedef Result (*Closure_CallIntoFn)(Option environment, Option arguments, void *output, size_t outputSize);
+
+/**
+ * Clones the environment of a closure.
+ * For closures whose environment is stored inline, storage is the uninitialized inline storage of the clone and the
+ * hook must initialize it returning storage itself; otherwise storage is `None` and the hook must return the new
+ * environment. Returning `None` makes the clone fail.
+ */
+typedef Option (*Closure_CloneFn)(Option environment, Option storage);
+
+/**
+ * The behaviour shared by every closure of the same kind, meant to be defined once as a static constant.
+ * Closures made from a class store just a pointer to it, so that they take a fraction of the memory.
+ */
+struct ClosureClass {
+    /** A human readable name, may be `NULL`. */
+    const char *name;
+    /** The size of the environment stored inline in every closure, 0 for environments living elsewhere. */
+    size_t environmentSize;
+    /** Mandatory. */
+    Closure_CallFn call;
+    /** Called on deletion to release the resources owned by the environment, may be `NULL`. */
+    Closure_DeleteFn delete;
+    /** A native implementation of `Closure_callBatch`, may be `NULL`. */
+    Closure_CallBatchFn callBatch;
+    /**
+     * Used by `Closure_clone`, may be `NULL`: inline environments are then copied bitwise, unless the class has a
+     * delete hook, in which case the environment is not cloned at all.
+     */
+    Closure_CloneFn clone;
+    /** Used by `Closure_callInto`, may be `NULL`. */
+    Closure_CallIntoFn callInto;
+};
+
 struct Closure;
 
+struct AlligatorArena;
+
 extern struct Closure *Closure_new(Option environment, Closure_CallFn callFn, Closure_DeleteFn deleteFn)
 __attribute__((__warn_unused_result__, __nonnull__(2, 3)));
 
+/**
+ * Creates a closure whose environment is stored inline, right after the closure itself, so that the closure and its
+ * environment are obtained with a single allocation.
+ * The storage is left uninitialized and is suitably aligned for any type, use `Closure_getEnvironment` to initialize it.
+ * On `Closure_delete`, deleteFn is called on the inline storage that must not be freed by deleteFn itself.
+ */
+extern struct Closure *Closure_newWithEnvironmentSize(size_t environmentSize, Closure_CallFn callFn, Closure_DeleteFn deleteFn)
+__attribute__((__warn_unused_result__, __nonnull__(2, 3)));
+
+/**
+ * Like `Closure_newWithEnvironmentSize` but both the closure and its environment are allocated from arena, the memory
+ * is reclaimed all at once by `AlligatorArena_reset` or `AlligatorArena_delete` and `Closure_delete` does not free it.
+ * Environments owning resources may opt in with a deleteFn: it is called exactly once, either on `Closure_delete`
+ * or when the arena is reset or deleted, whichever comes first; deleteFn may be `NULL` to opt out.
+ */
+extern struct Closure *
+Closure_newInArena(struct AlligatorArena *arena, size_t environmentSize, Closure_CallFn callFn, Closure_DeleteFn deleteFn)
+__attribute__((__warn_unused_result__, __nonnull__(1, 3)));
+
+/**
+ * Creates a closure of the given class.
+ * If class has an environmentSize, the environment is stored inline and initialized copying environmentSize bytes
+ * from the value of environment, or left uninitialized if environment is `None`; otherwise environment is referenced
+ * as is and released by the delete hook of class, if any.
+ */
+extern struct Closure *Closure_newFromClass(const struct ClosureClass *class, Option environment)
+__attribute__((__warn_unused_result__, __nonnull__(1)));
+
+/**
+ * Creates a new closure of the same class with a copy of the environment of this closure, obtained through the clone
+ * hook of the class or bitwise for inline environments without a delete hook.
+ * Returns `None` if the environment can't be copied; clones of arena closures are not allocated from the arena.
+ */
+extern Option Closure_clone(struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns the class of this closure; closures made up of bare function pointers share an interned class, whose
+ * environmentSize is always 0 as closures of the same functions may have inline environments of different sizes.
+ */
+extern const struct ClosureClass *Closure_getClass(const struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns the environment of this closure.
+ */
+extern Option Closure_getEnvironment(struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
 extern Result Closure_call(struct Closure *closure)
 __attribute__((__nonnull__));
 
 extern Result Closure_callWith(struct Closure *closure, Option arguments)
 __attribute__((__nonnull__(1)));
 
+/**
+ * Calls the closure letting it write its value to the outputSize bytes pointed by output instead of allocating it,
+ * the returned `Result` is ok with output itself or carries the error.
+ * Returns an `IllegalState` error if the class of the closure has no callInto hook.
+ */
+extern Result Closure_callInto(struct Closure *closure, Option arguments, void *output, size_t outputSize)
+__attribute__((__warn_unused_result__, __nonnull__(1, 3)));
+
+/**
+ * Calls the closure through `Closure_callInto` yielding a typed result Name, generated by `RESULT_DEFINE_TYPED`,
+ * whose value lives inline in the result itself, e.g. `ResultInt r = Closure_callAs(ResultInt, closure, arguments);`
+ */
+#define Closure_callAs(Name, closure, arguments)                                                                       \
+    __extension__ ({                                                                                                   \
+        Name __typed = {.__error=Ok};                                                                                  \
+        __typed.__error = Result_inspect(                                                                              \
+            Closure_callInto((closure), (arguments), &__typed.__value, sizeof(__typed.__value))                        \
+        );                                                                                                             \
+        __typed;                                                                                                       \
+    })
+
+/**
+ * Registers an implementation of `Closure_callInto` for this closure, callIntoFn may be `NULL` to remove it.
+ * The closure is switched to an interned copy of its class, so that other closures of the same class are not affected.
+ */
+extern void Closure_setCallInto(struct Closure *closure, Closure_CallIntoFn callIntoFn)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Registers a native implementation of `Closure_callBatch` for this closure, that will be used instead of calling
+ * callFn once per argument; callBatchFn may be `NULL` to restore the default behaviour.
+ * The closure is switched to an interned copy of its class, so that other closures of the same class are not affected.
+ */
+extern void Closure_setCallBatch(struct Closure *closure, Closure_CallBatchFn callBatchFn)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Applies this closure to each one of the n arguments, storing the i-th result in out[i].
+ */
+extern void Closure_callBatch(struct Closure *closure, const Option *arguments, Result *out, size_t n)
+__attribute__((__nonnull__));
+
+/**
+ * Adds a reference to this closure, that can be shared among threads; every reference must be dropped by either
+ * `Closure_release` or `Closure_delete`.
+ * Returns closure itself.
+ */
+extern struct Closure *Closure_retain(struct Closure *closure)
+__attribute__((__nonnull__));
+
+/**
+ * Drops a reference to this closure, the last one deletes the closure calling deleteFn exactly once, even if the
+ * references are dropped concurrently.
+ * A closure owned by a single reference is deleted without any atomic read-modify-write.
+ */
+extern void Closure_release(struct Closure *closure);
+
+/**
+ * Like `Closure_retain` but without atomic operations.
+ *
+ * @attention must not be used on closures whose references are being retained or released by other threads.
+ */
+extern struct Closure *Closure_retainNonAtomic(struct Closure *closure)
+__attribute__((__nonnull__));
+
+/**
+ * Like `Closure_release` but without atomic operations.
+ *
+ * @attention must not be used on closures whose references are being retained or released by other threads.
+ */
+extern void Closure_releaseNonAtomic(struct Closure *closure);
+
+/**
+ * Drops the reference owned by the caller, same as `Closure_release`: closures never retained are deleted immediately.
+ */
 extern void Closure_delete(struct Closure *closure);
 
 #ifdef __cplusplus
@@ -0,0 +1,59 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Internal helpers shared by the modules of this library, not part of its interface.
+ */
+
+/**
+ * The alignment of the members and structs meant to avoid false sharing.
+ */
+#define CLOSURE_CACHE_LINE_SIZE     64
+
+/**
+ * Allocates size bytes aligned to `CLOSURE_CACHE_LINE_SIZE`, terminating on failure; allocation is set to the memory
+ * to be passed to `Alligator_free` once done with it.
+ * Allocators guarantee only the fundamental alignment: the cache line alignment is obtained by over-allocating.
+ */
+extern void *__Closure_allocateAligned(size_t size, void **allocation)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,457 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <panic/panic.h>
+#include <alligator/alligator.h>
+#include "closure_aligned.h"
+#include "closure_executor.h"
+
+#define DEQUE_INITIAL_CAPACITY  256
+#define STEAL_ATTEMPTS          4
+
+/*
+ * ClosureFuture
+ */
+enum ClosureFutureState {
+    ClosureFutureState_Pending, ClosureFutureState_Ready
+};
+
+struct ClosureFuture {
+    struct ClosureFuture *next;     // link in the injection stacks
+    struct Closure *closure;
+    Result result;
+    int state;                      // enum ClosureFutureState, accessed atomically
+    int references;                 // held by the executor until called and by the submitter until deleted
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+};
+
+static struct ClosureFuture *ClosureFuture_new(struct Closure *closure);
+
+static void ClosureFuture_resolve(struct ClosureFuture *self, Result result);
+
+static void ClosureFuture_release(struct ClosureFuture *self);
+
+/*
+ * ClosureDeque: Chase-Lev work-stealing deque, see "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * by Lê, Pop, Cohen and Zappa Nardelli.
+ */
+struct ClosureDequeArray {
+    struct ClosureDequeArray *retired;  // arrays replaced by a larger one are freed only with the deque
+    long capacity;
+    struct ClosureFuture *slots[];
+};
+
+struct ClosureDeque {
+    long top __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    long bottom __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    struct ClosureDequeArray *array;
+};
+
+static void ClosureDeque_init(struct ClosureDeque *self);
+
+static void ClosureDeque_push(struct ClosureDeque *self, struct ClosureFuture *future);
+
+static struct ClosureFuture *ClosureDeque_take(struct ClosureDeque *self);
+
+static struct ClosureFuture *ClosureDeque_steal(struct ClosureDeque *self);
+
+static void ClosureDeque_destroy(struct ClosureDeque *self);
+
+/*
+ * ClosureWorker
+ */
+struct ClosureWorker {
+    struct ClosureDeque deque;
+    struct ClosureFuture *injected __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));  // lock-free stack
+    struct ClosureExecutor *executor;
+    pthread_t thread;
+    uint64_t seed;
+} __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+
+static void *ClosureWorker_run(void *self);
+
+/*
+ * ClosureExecutor
+ */
+struct ClosureExecutor {
+    void *allocation;           // the allocations self and workers are aligned within, to be freed
+    void *workersAllocation;
+    struct ClosureWorker *workers;
+    size_t threads;
+    size_t next __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));  // round-robin index for external submissions
+    unsigned long epoch __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    int sleepers;
+    bool shutdown;
+    pthread_mutex_t mutex;      // used only to park and wake up idle workers
+    pthread_cond_t condition;
+};
+
+static __thread struct ClosureWorker *currentWorker = NULL;
+
+static void ClosureExecutor_wakeUp(struct ClosureExecutor *self, bool everyone);
+
+/*
+ * IMPLEMENTATION
+ */
+
+/*
+ * ClosureFuture
+ */
+struct ClosureFuture *ClosureFuture_new(struct Closure *closure) {
+    struct ClosureFuture *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+    self->next = NULL;
+    self->closure = closure;
+    self->result = Result_error(IllegalState);
+    self->state = ClosureFutureState_Pending;
+    self->references = 2;
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->condition, NULL);
+    return self;
+}
+
+void ClosureFuture_resolve(struct ClosureFuture *self, Result result) {
+    pthread_mutex_lock(&self->mutex);
+    self->result = result;
+    __atomic_store_n(&self->state, ClosureFutureState_Ready, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&self->condition);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+void ClosureFuture_release(struct ClosureFuture *self) {
+    if (1 == __atomic_fetch_sub(&self->references, 1, __ATOMIC_ACQ_REL)) {
+        pthread_cond_destroy(&self->condition);
+        pthread_mutex_destroy(&self->mutex);
+        Alligator_free(self);
+    }
+}
+
+bool ClosureFuture_isReady(const struct ClosureFuture *const future) {
+    assert(future);
+    return ClosureFutureState_Ready == __atomic_load_n(&future->state, __ATOMIC_ACQUIRE);
+}
+
+Result ClosureFuture_wait(struct ClosureFuture *const future) {
+    assert(future);
+    if (!ClosureFuture_isReady(future)) {
+        pthread_mutex_lock(&future->mutex);
+        while (!ClosureFuture_isReady(future)) {
+            pthread_cond_wait(&future->condition, &future->mutex);
+        }
+        pthread_mutex_unlock(&future->mutex);
+    }
+    return future->result;
+}
+
+void ClosureFuture_delete(struct ClosureFuture *const future) {
+    if (future) {
+        ClosureFuture_release(future);
+    }
+}
+
+/*
+ * ClosureDeque
+ */
+static struct ClosureDequeArray *ClosureDequeArray_new(const long capacity, struct ClosureDequeArray *retired) {
+    struct ClosureDequeArray *self = Option_unwrap(
+            Alligator_malloc(sizeof(*self) + (size_t) capacity * sizeof(self->slots[0]))
+    );
+    self->retired = retired;
+    self->capacity = capacity;
+    return self;
+}
+
+void ClosureDeque_init(struct ClosureDeque *const self) {
+    self->top = 0;
+    self->bottom = 0;
+    self->array = ClosureDequeArray_new(DEQUE_INITIAL_CAPACITY, NULL);
+}
+
+/*
+ * Owner only.
+ */
+void ClosureDeque_push(struct ClosureDeque *const self, struct ClosureFuture *const future) {
+    const long bottom = __atomic_load_n(&self->bottom, __ATOMIC_RELAXED);
+    const long top = __atomic_load_n(&self->top, __ATOMIC_ACQUIRE);
+    struct ClosureDequeArray *array = __atomic_load_n(&self->array, __ATOMIC_RELAXED);
+    if (bottom - top > array->capacity - 1) {
+        struct ClosureDequeArray *grown = ClosureDequeArray_new(array->capacity * 2, array);
+        for (long i = top; i < bottom; i++) {
+            grown->slots[i % grown->capacity] = __atomic_load_n(&array->slots[i % array->capacity], __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&self->array, grown, __ATOMIC_RELEASE);
+        array = grown;
+    }
+    __atomic_store_n(&array->slots[bottom % array->capacity], future, __ATOMIC_RELAXED);
+    __atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Owner only.
+ */
+struct ClosureFuture *ClosureDeque_take(struct ClosureDeque *const self) {
+    const long bottom = __atomic_load_n(&self->bottom, __ATOMIC_RELAXED) - 1;
+    struct ClosureDequeArray *array = __atomic_load_n(&self->array, __ATOMIC_RELAXED);
+    __atomic_store_n(&self->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&self->top, __ATOMIC_RELAXED);
+    struct ClosureFuture *future = NULL;
+    if (top <= bottom) {
+        future = __atomic_load_n(&array->slots[bottom % array->capacity], __ATOMIC_RELAXED);
+        if (top == bottom) {
+            // last element: race against thieves
+            if (!__atomic_compare_exchange_n(&self->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                future = NULL;
+            }
+            __atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return future;
+}
+
+/*
+ * Any thread.
+ */
+struct ClosureFuture *ClosureDeque_steal(struct ClosureDeque *const self) {
+    long top = __atomic_load_n(&self->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    const long bottom = __atomic_load_n(&self->bottom, __ATOMIC_ACQUIRE);
+    if (top < bottom) {
+        struct ClosureDequeArray *array = __atomic_load_n(&self->array, __ATOMIC_ACQUIRE);
+        struct ClosureFuture *future = __atomic_load_n(&array->slots[top % array->capacity], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&self->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return future;
+        }
+    }
+    return NULL;
+}
+
+void ClosureDeque_destroy(struct ClosureDeque *const self) {
+    for (struct ClosureDequeArray *array = self->array, *retired; array; array = retired) {
+        retired = array->retired;
+        Alligator_free(array);
+    }
+}
+
+/*
+ * ClosureWorker
+ */
+static void ClosureWorker_inject(struct ClosureWorker *const self, struct ClosureFuture *const future) {
+    future->next = __atomic_load_n(&self->injected, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&self->injected, &future->next, future, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+}
+
+/*
+ * Moves every closure injected into victim to the deque of self and returns the oldest one.
+ */
+static struct ClosureFuture *ClosureWorker_takeInjected(struct ClosureWorker *const self,
+                                                        struct ClosureWorker *const victim) {
+    struct ClosureFuture *stack = __atomic_exchange_n(&victim->injected, NULL, __ATOMIC_ACQUIRE);
+    if (NULL == stack) {
+        return NULL;
+    }
+    // the stack is LIFO: reverse it in order to restore the submission order
+    struct ClosureFuture *queue = NULL;
+    for (struct ClosureFuture *next; stack; stack = next) {
+        next = stack->next;
+        stack->next = queue;
+        queue = stack;
+    }
+    for (struct ClosureFuture *future = queue->next; future; future = future->next) {
+        ClosureDeque_push(&self->deque, future);
+    }
+    return queue;
+}
+
+static uint64_t ClosureWorker_random(struct ClosureWorker *const self) {
+    // xorshift64
+    self->seed ^= self->seed << 13;
+    self->seed ^= self->seed >> 7;
+    self->seed ^= self->seed << 17;
+    return self->seed;
+}
+
+static struct ClosureFuture *ClosureWorker_find(struct ClosureWorker *const self) {
+    struct ClosureExecutor *const executor = self->executor;
+    struct ClosureFuture *future = ClosureDeque_take(&self->deque);
+    if (NULL == future) {
+        future = ClosureWorker_takeInjected(self, self);
+    }
+    for (size_t attempt = 0; NULL == future && attempt < STEAL_ATTEMPTS * executor->threads; attempt++) {
+        struct ClosureWorker *victim = &executor->workers[ClosureWorker_random(self) % executor->threads];
+        if (victim != self) {
+            future = ClosureDeque_steal(&victim->deque);
+            if (NULL == future) {
+                future = ClosureWorker_takeInjected(self, victim);
+            }
+        }
+    }
+    // one last exhaustive sweep, random victims may have missed some work
+    for (size_t i = 0; NULL == future && i < executor->threads; i++) {
+        future = ClosureDeque_steal(&executor->workers[i].deque);
+        if (NULL == future) {
+            future = ClosureWorker_takeInjected(self, &executor->workers[i]);
+        }
+    }
+    return future;
+}
+
+static void ClosureWorker_execute(struct ClosureFuture *const future) {
+    struct Closure *closure = future->closure;
+    future->closure = NULL;
+    const Result result = Closure_call(closure);
+    Closure_delete(closure);
+    ClosureFuture_resolve(future, result);
+    ClosureFuture_release(future);
+}
+
+void *ClosureWorker_run(void *const worker) {
+    struct ClosureWorker *const self = worker;
+    struct ClosureExecutor *const executor = self->executor;
+    currentWorker = self;
+    while (true) {
+        struct ClosureFuture *future = ClosureWorker_find(self);
+        if (NULL == future) {
+            // announce that we are going to sleep, then look for work once more before actually sleeping
+            const unsigned long epoch = __atomic_load_n(&executor->epoch, __ATOMIC_ACQUIRE);
+            __atomic_fetch_add(&executor->sleepers, 1, __ATOMIC_SEQ_CST);
+            future = ClosureWorker_find(self);
+            if (NULL == future) {
+                if (__atomic_load_n(&executor->shutdown, __ATOMIC_ACQUIRE)) {
+                    __atomic_fetch_sub(&executor->sleepers, 1, __ATOMIC_SEQ_CST);
+                    break;
+                }
+                pthread_mutex_lock(&executor->mutex);
+                while (epoch == __atomic_load_n(&executor->epoch, __ATOMIC_ACQUIRE) &&
+                       !__atomic_load_n(&executor->shutdown, __ATOMIC_ACQUIRE)) {
+                    pthread_cond_wait(&executor->condition, &executor->mutex);
+                }
+                pthread_mutex_unlock(&executor->mutex);
+            }
+            __atomic_fetch_sub(&executor->sleepers, 1, __ATOMIC_SEQ_CST);
+        }
+        if (future) {
+            ClosureWorker_execute(future);
+        }
+    }
+    currentWorker = NULL;
+    return NULL;
+}
+
+/*
+ * ClosureExecutor
+ */
+struct ClosureExecutor *ClosureExecutor_new(size_t threads) {
+    if (0 == threads) {
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (size_t) cores : 1;
+    }
+    void *allocation;
+    struct ClosureExecutor *self = __Closure_allocateAligned(sizeof(*self), &allocation);
+    self->allocation = allocation;
+    self->workers = __Closure_allocateAligned(threads * sizeof(self->workers[0]), &self->workersAllocation);
+    memset(self->workers, 0, threads * sizeof(self->workers[0]));
+    self->threads = threads;
+    self->next = 0;
+    self->epoch = 0;
+    self->sleepers = 0;
+    self->shutdown = false;
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->condition, NULL);
+    for (size_t i = 0; i < threads; i++) {
+        struct ClosureWorker *worker = &self->workers[i];
+        ClosureDeque_init(&worker->deque);
+        worker->injected = NULL;
+        worker->executor = self;
+        worker->seed = 0x9E3779B97F4A7C15u * (i + 1);
+    }
+    for (size_t i = 0; i < threads; i++) {
+        if (0 != pthread_create(&self->workers[i].thread, NULL, ClosureWorker_run, &self->workers[i])) {
+            Panic_terminate("Unable to start executor worker %zu of %zu\n", i + 1, threads);
+        }
+    }
+    return self;
+}
+
+size_t ClosureExecutor_threads(const struct ClosureExecutor *const executor) {
+    assert(executor);
+    return executor->threads;
+}
+
+void ClosureExecutor_wakeUp(struct ClosureExecutor *const self, const bool everyone) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (everyone || __atomic_load_n(&self->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&self->mutex);
+        __atomic_fetch_add(&self->epoch, 1, __ATOMIC_RELEASE);
+        if (everyone) {
+            pthread_cond_broadcast(&self->condition);
+        } else {
+            pthread_cond_signal(&self->condition);
+        }
+        pthread_mutex_unlock(&self->mutex);
+    }
+}
+
+struct ClosureFuture *ClosureExecutor_submit(struct ClosureExecutor *const executor, struct Closure *const closure) {
+    assert(executor);
+    assert(closure);
+    struct ClosureFuture *future = ClosureFuture_new(closure);
+    if (currentWorker && currentWorker->executor == executor) {
+        ClosureDeque_push(&currentWorker->deque, future);
+    } else {
+        const size_t next = __atomic_fetch_add(&executor->next, 1, __ATOMIC_RELAXED);
+        ClosureWorker_inject(&executor->workers[next % executor->threads], future);
+    }
+    ClosureExecutor_wakeUp(executor, false);
+    return future;
+}
+
+void ClosureExecutor_delete(struct ClosureExecutor *const executor) {
+    if (executor) {
+        assert(currentWorker == NULL || currentWorker->executor != executor);
+        __atomic_store_n(&executor->shutdown, true, __ATOMIC_RELEASE);
+        ClosureExecutor_wakeUp(executor, true);
+        for (size_t i = 0; i < executor->threads; i++) {
+            pthread_join(executor->workers[i].thread, NULL);
+        }
+        for (size_t i = 0; i < executor->threads; i++) {
+            ClosureDeque_destroy(&executor->workers[i].deque);
+        }
+        pthread_cond_destroy(&executor->condition);
+        pthread_mutex_destroy(&executor->mutex);
+        Alligator_free(executor->workersAllocation);
+        Alligator_free(executor->allocation);
+    }
+}
@@ -0,0 +1,107 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <result/result.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A work-stealing thread pool running closures asynchronously.
+ *
+ * Every worker owns a Chase-Lev deque: closures submitted by a worker are pushed to its own deque, closures submitted
+ * by any other thread are handed to the workers in round-robin through lock-free injection stacks; idle workers steal
+ * from random victims and sleep only when there is nothing left to steal.
+ */
+struct ClosureExecutor;
+
+/**
+ * A handle to the `Result` of a closure submitted to a `ClosureExecutor`.
+ */
+struct ClosureFuture;
+
+/**
+ * Creates an executor with the given number of worker threads, 0 means one worker per online core.
+ */
+extern struct ClosureExecutor *ClosureExecutor_new(size_t threads)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Returns the number of worker threads of this executor.
+ */
+extern size_t ClosureExecutor_threads(const struct ClosureExecutor *executor)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Schedules closure to be called, without arguments, by one of the workers of this executor.
+ * The executor takes ownership of the caller's reference to closure and releases it once called, the same closure can
+ * be submitted more than once by retaining it first with `Closure_retain`.
+ * Returns a future resolving to the `Result` of the call, that must be released with `ClosureFuture_delete`.
+ *
+ * @attention closures must not be submitted to an executor being deleted.
+ */
+extern struct ClosureFuture *ClosureExecutor_submit(struct ClosureExecutor *executor, struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Runs every closure already submitted, then stops and releases this executor along with its workers.
+ * Futures are not invalidated and must still be released with `ClosureFuture_delete`.
+ */
+extern void ClosureExecutor_delete(struct ClosureExecutor *executor);
+
+/**
+ * Returns `true` if the closure has been called, `false` otherwise.
+ */
+extern bool ClosureFuture_isReady(const struct ClosureFuture *future)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Blocks until the closure has been called and returns its `Result`; the `Result` can be waited for more than once.
+ *
+ * @attention waiting from inside a closure running on the same executor may deadlock if every worker does so.
+ */
+extern Result ClosureFuture_wait(struct ClosureFuture *future)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Releases this future, it may be called before the closure has been called in order to discard its `Result`.
+ */
+extern void ClosureFuture_delete(struct ClosureFuture *future);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,340 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include "closure_generator.h"
+
+#define CHUNK   64
+
+struct ClosureGeneratorRange {
+    intptr_t next;
+    intptr_t stop;
+    intptr_t step;
+};
+
+struct ClosureGeneratorSlice {
+    unsigned char *next;
+    unsigned char *end;
+    size_t elementSize;
+};
+
+struct ClosureGeneratorMap {
+    struct Closure *generator;
+    Result (*f)(Result_Value);
+};
+
+struct ClosureGeneratorFilter {
+    struct Closure *generator;
+    bool (*predicate)(Result_Value);
+};
+
+static Result ClosureGeneratorRange_call(Option environment, Option arguments);
+
+static void ClosureGeneratorRange_callBatch(Option environment, const Option *arguments, Result *out, size_t n);
+
+static Result ClosureGeneratorSlice_call(Option environment, Option arguments);
+
+static void ClosureGeneratorSlice_callBatch(Option environment, const Option *arguments, Result *out, size_t n);
+
+static Result ClosureGeneratorMap_call(Option environment, Option arguments);
+
+static void ClosureGeneratorMap_callBatch(Option environment, const Option *arguments, Result *out, size_t n);
+
+static Result ClosureGeneratorFilter_call(Option environment, Option arguments);
+
+static void ClosureGeneratorFilter_callBatch(Option environment, const Option *arguments, Result *out, size_t n);
+
+static Option ClosureGeneratorMap_clone(Option environment, Option storage);
+
+static Option ClosureGeneratorFilter_clone(Option environment, Option storage);
+
+static void ClosureGenerator_deleteSource(Option environment);
+
+static Option ClosureGenerator_cloneSource(Option storage);
+
+static const struct ClosureClass ClosureGeneratorRange_class = {
+        .name="ClosureGeneratorRange",
+        .environmentSize=sizeof(struct ClosureGeneratorRange),
+        .call=ClosureGeneratorRange_call,
+        .callBatch=ClosureGeneratorRange_callBatch,
+};
+
+static const struct ClosureClass ClosureGeneratorSlice_class = {
+        .name="ClosureGeneratorSlice",
+        .environmentSize=sizeof(struct ClosureGeneratorSlice),
+        .call=ClosureGeneratorSlice_call,
+        .callBatch=ClosureGeneratorSlice_callBatch,
+};
+
+static const struct ClosureClass ClosureGeneratorMap_class = {
+        .name="ClosureGeneratorMap",
+        .environmentSize=sizeof(struct ClosureGeneratorMap),
+        .call=ClosureGeneratorMap_call,
+        .delete=ClosureGenerator_deleteSource,
+        .callBatch=ClosureGeneratorMap_callBatch,
+        .clone=ClosureGeneratorMap_clone,
+};
+
+static const struct ClosureClass ClosureGeneratorFilter_class = {
+        .name="ClosureGeneratorFilter",
+        .environmentSize=sizeof(struct ClosureGeneratorFilter),
+        .call=ClosureGeneratorFilter_call,
+        .delete=ClosureGenerator_deleteSource,
+        .callBatch=ClosureGeneratorFilter_callBatch,
+        .clone=ClosureGeneratorFilter_clone,
+};
+
+/*
+ * Every argument of a batch is ignored, so a single array of `None` fits batches of any size up to CHUNK.
+ */
+static const Option NO_ARGUMENTS[CHUNK] = {{0}};
+
+/*
+ * IMPLEMENTATION
+ */
+ResultSize ClosureGenerator_nextN(struct Closure *const generator, Result_Value *const out, const size_t n) {
+    assert(generator);
+    assert(out);
+    size_t count = 0;
+    if (NULL == Closure_getClass(generator)->callBatch) {
+        // pulling a chunk would call an exhausted generator up to CHUNK - 1 times for nothing
+        while (count < n) {
+            const Result result = Closure_call(generator);
+            if (Result_isError(result)) {
+                return StopIteration == Result_inspect(result) ? ResultSize_ok(count)
+                                                               : ResultSize_error(Result_inspect(result));
+            }
+            out[count++] = Result_unwrap(result);
+        }
+        return ResultSize_ok(count);
+    }
+    Result results[CHUNK];
+    while (count < n) {
+        const size_t chunk = n - count < CHUNK ? n - count : CHUNK;
+        Closure_callBatch(generator, NO_ARGUMENTS, results, chunk);
+        for (size_t i = 0; i < chunk; i++) {
+            if (Result_isError(results[i])) {
+                return StopIteration == Result_inspect(results[i]) ? ResultSize_ok(count)
+                                                                   : ResultSize_error(Result_inspect(results[i]));
+            }
+            out[count++] = Result_unwrap(results[i]);
+        }
+    }
+    return ResultSize_ok(count);
+}
+
+struct Closure *ClosureGenerator_range(const intptr_t start, const intptr_t stop, const intptr_t step) {
+    assert(0 != step);
+    const struct ClosureGeneratorRange environment = {.next=start, .stop=stop, .step=step};
+    return Closure_newFromClass(&ClosureGeneratorRange_class, Option_some((Option_Value) &environment));
+}
+
+struct Closure *ClosureGenerator_slice(void *const array, const size_t elementSize, const size_t length) {
+    assert(array || 0 == length);
+    assert(elementSize > 0);
+    const struct ClosureGeneratorSlice environment = {
+            .next=array, .end=(unsigned char *) array + elementSize * length, .elementSize=elementSize
+    };
+    return Closure_newFromClass(&ClosureGeneratorSlice_class, Option_some((Option_Value) &environment));
+}
+
+struct Closure *ClosureGenerator_map(struct Closure *const generator, Result (*const f)(Result_Value)) {
+    assert(generator);
+    assert(f);
+    const struct ClosureGeneratorMap environment = {.generator=generator, .f=f};
+    return Closure_newFromClass(&ClosureGeneratorMap_class, Option_some((Option_Value) &environment));
+}
+
+struct Closure *ClosureGenerator_filter(struct Closure *const generator, bool (*const predicate)(Result_Value)) {
+    assert(generator);
+    assert(predicate);
+    const struct ClosureGeneratorFilter environment = {.generator=generator, .predicate=predicate};
+    return Closure_newFromClass(&ClosureGeneratorFilter_class, Option_some((Option_Value) &environment));
+}
+
+/*
+ * Range
+ */
+/*
+ * Distances and counts are computed on uintptr_t, so that ranges spanning more than INTPTR_MAX don't overflow, and
+ * the position is moved to stop instead of past it once the range is over.
+ */
+static uintptr_t ClosureGeneratorRange_remaining(const struct ClosureGeneratorRange *const self) {
+    if (self->step > 0) {
+        return self->next < self->stop
+               ? ((uintptr_t) self->stop - (uintptr_t) self->next - 1) / (uintptr_t) self->step + 1 : 0;
+    }
+    return self->next > self->stop
+           ? ((uintptr_t) self->next - (uintptr_t) self->stop - 1) / (0 - (uintptr_t) self->step) + 1 : 0;
+}
+
+Result ClosureGeneratorRange_call(Option environment, Option arguments) {
+    (void) arguments;
+    struct ClosureGeneratorRange *self = Option_unwrap(environment);
+    const uintptr_t remaining = ClosureGeneratorRange_remaining(self);
+    if (0 == remaining) {
+        return Result_error(StopIteration);
+    }
+    const intptr_t value = self->next;
+    self->next = remaining > 1 ? value + self->step : self->stop;
+    return Result_ok((Result_Value) value);
+}
+
+void ClosureGeneratorRange_callBatch(Option environment, const Option *arguments, Result *out, size_t n) {
+    (void) arguments;
+    struct ClosureGeneratorRange *self = Option_unwrap(environment);
+    const uintptr_t step = (uintptr_t) self->step;
+    const uintptr_t available = ClosureGeneratorRange_remaining(self);
+    const size_t produced = available < n ? (size_t) available : n;
+    uintptr_t value = (uintptr_t) self->next;
+    for (size_t i = 0; i < produced; i++, value += step) {
+        out[i] = Result_ok((Result_Value) value);
+    }
+    for (size_t i = produced; i < n; i++) {
+        out[i] = Result_error(StopIteration);
+    }
+    self->next = produced < available ? (intptr_t) value : self->stop;
+}
+
+/*
+ * Slice
+ */
+Result ClosureGeneratorSlice_call(Option environment, Option arguments) {
+    (void) arguments;
+    struct ClosureGeneratorSlice *self = Option_unwrap(environment);
+    if (self->next >= self->end) {
+        return Result_error(StopIteration);
+    }
+    unsigned char *value = self->next;
+    self->next += self->elementSize;
+    return Result_ok(value);
+}
+
+void ClosureGeneratorSlice_callBatch(Option environment, const Option *arguments, Result *out, size_t n) {
+    (void) arguments;
+    struct ClosureGeneratorSlice *self = Option_unwrap(environment);
+    const size_t elementSize = self->elementSize;
+    const size_t available = (size_t) (self->end - self->next) / elementSize;
+    const size_t produced = available < n ? available : n;
+    unsigned char *value = self->next;
+    for (size_t i = 0; i < produced; i++, value += elementSize) {
+        out[i] = Result_ok(value);
+    }
+    for (size_t i = produced; i < n; i++) {
+        out[i] = Result_error(StopIteration);
+    }
+    self->next = value;
+}
+
+/*
+ * Map
+ */
+Result ClosureGeneratorMap_call(Option environment, Option arguments) {
+    (void) arguments;
+    struct ClosureGeneratorMap *self = Option_unwrap(environment);
+    return Result_chain(Closure_call(self->generator), self->f);
+}
+
+void ClosureGeneratorMap_callBatch(Option environment, const Option *arguments, Result *out, size_t n) {
+    struct ClosureGeneratorMap *self = Option_unwrap(environment);
+    Result (*const f)(Result_Value) = self->f;
+    Closure_callBatch(self->generator, arguments, out, n);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = Result_chain(out[i], f);
+    }
+}
+
+Option ClosureGeneratorMap_clone(Option environment, Option storage) {
+    *(struct ClosureGeneratorMap *) Option_unwrap(storage) = *(struct ClosureGeneratorMap *) Option_unwrap(environment);
+    return ClosureGenerator_cloneSource(storage);
+}
+
+/*
+ * Filter
+ */
+Result ClosureGeneratorFilter_call(Option environment, Option arguments) {
+    (void) arguments;
+    struct ClosureGeneratorFilter *self = Option_unwrap(environment);
+    while (true) {
+        const Result result = Closure_call(self->generator);
+        if (Result_isError(result) || self->predicate(Result_unwrap(result))) {
+            return result;
+        }
+    }
+}
+
+/*
+ * Pulls chunks from the source until out is full, the elements following an error in a chunk are dropped, like the
+ * ones of `ClosureGenerator_nextN`.
+ */
+void ClosureGeneratorFilter_callBatch(Option environment, const Option *arguments, Result *out, size_t n) {
+    (void) arguments;
+    struct ClosureGeneratorFilter *self = Option_unwrap(environment);
+    bool (*const predicate)(Result_Value) = self->predicate;
+    Result results[CHUNK];
+    size_t count = 0;
+    while (count < n) {
+        const size_t chunk = n - count < CHUNK ? n - count : CHUNK;
+        Closure_callBatch(self->generator, NO_ARGUMENTS, results, chunk);
+        for (size_t i = 0; i < chunk; i++) {
+            if (Result_isError(results[i])) {
+                while (count < n) {
+                    out[count++] = results[i];
+                }
+                return;
+            }
+            if (predicate(Result_unwrap(results[i]))) {
+                out[count++] = results[i];
+            }
+        }
+    }
+}
+
+Option ClosureGeneratorFilter_clone(Option environment, Option storage) {
+    *(struct ClosureGeneratorFilter *) Option_unwrap(storage) =
+            *(struct ClosureGeneratorFilter *) Option_unwrap(environment);
+    return ClosureGenerator_cloneSource(storage);
+}
+
+/*
+ * Replaces the source of a bitwise copy of a map or filter environment with a clone of its own.
+ */
+Option ClosureGenerator_cloneSource(Option storage) {
+    struct Closure **generator = Option_unwrap(storage);
+    const Option source = Closure_clone(*generator);
+    if (Option_isNone(source)) {
+        return None;
+    }
+    *generator = Option_unwrap(source);
+    return storage;
+}
+
+void ClosureGenerator_deleteSource(Option environment) {
+    // the source is the first member of both map and filter environments
+    struct Closure **generator = Option_unwrap(environment);
+    Closure_delete(*generator);
+}
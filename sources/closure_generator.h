@@ -0,0 +1,123 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <error/error.h>
+#include <option/option.h>
+#include <result/result.h>
+#include <result/result_typed.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Generators are closures producing the next element of a sequence on each `Closure_call` as an `Ok` result, and an
+ * `Error` result of `StopIteration`, from then on, when the sequence is over.
+ * Generators may implement the callBatch hook of their class, ignoring the arguments, to let `ClosureGenerator_nextN`
+ * pull many elements at once; the generators made by this module do.
+ *
+ * The state of a generator lives in its environment; the following macros let a call function resume from the last
+ * element yielded instead of being written as a state machine. Local variables are not preserved across yields and
+ * must be stored in the environment as well, and yields must not appear inside a switch statement, e.g.
+ *
+ * @code
+ * struct Fibonacci { int resume; uintptr_t a, b; };
+ *
+ * static Result Fibonacci_call(Option environment, Option arguments) {
+ *     struct Fibonacci *self = Option_unwrap(environment);
+ *     ClosureGenerator_begin(&self->resume);
+ *     for (self->a = 0, self->b = 1; self->a < 1000; self->b += self->a, self->a = self->b - self->a) {
+ *         ClosureGenerator_yield(&self->resume, (Result_Value) self->a);
+ *     }
+ *     ClosureGenerator_end(&self->resume);
+ * }
+ * @endcode
+ */
+#define ClosureGenerator_begin(resume) \
+    switch (*(resume)) { case 0:
+
+/**
+ * Returns value as the next element, the next call resumes right after this point.
+ */
+#define ClosureGenerator_yield(resume, value) \
+    do { *(resume) = __LINE__; return Result_ok((value)); case __LINE__:; } while (0)
+
+/**
+ * Ends the sequence, every call from now on returns `StopIteration`.
+ */
+#define ClosureGenerator_end(resume) \
+    } *(resume) = -1; return Result_error(StopIteration)
+
+/**
+ * Pulls at most n elements from generator storing them in out, batching the calls if generator supports it.
+ * Returns the number of elements stored, less than n only if the sequence is over, or the error of generator if it
+ * fails, in which case the elements stored in out meanwhile are dropped.
+ */
+extern ResultSize ClosureGenerator_nextN(struct Closure *generator, Result_Value *out, size_t n)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Creates a generator of the integers from start, included, to stop, excluded, by step, that must not be 0; elements
+ * are integers cast to `Result_Value`, to be read back with `(intptr_t) value`.
+ */
+extern struct Closure *ClosureGenerator_range(intptr_t start, intptr_t stop, intptr_t step)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Creates a generator of the addresses of the length elements, elementSize bytes each, of array.
+ */
+extern struct Closure *ClosureGenerator_slice(void *array, size_t elementSize, size_t length)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Creates a generator of the results of f applied to the elements of generator, taking ownership of it; errors
+ * returned by f are returned as they are.
+ * `Closure_clone` clones generator too, and fails if generator can't be cloned.
+ */
+extern struct Closure *ClosureGenerator_map(struct Closure *generator, Result (*f)(Result_Value))
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Creates a generator of the elements of generator satisfying predicate, taking ownership of generator.
+ * `Closure_clone` clones generator too, and fails if generator can't be cloned.
+ */
+extern struct Closure *ClosureGenerator_filter(struct Closure *generator, bool (*predicate)(Result_Value))
+__attribute__((__warn_unused_result__, __nonnull__));
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,255 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <alligator/alligator.h>
+#include "closure_instrumentation.h"
+
+#if defined(CLOSURE_INSTRUMENTATION)
+
+#define CLOSURE_STATS_SLOTS     64  // per thread, must be a power of 2
+
+/*
+ * Every thread records into its own table, registered in a global list so that reports can sum all tables up;
+ * a table is merged into the retired one when its thread exits.
+ * Counters are written only by the owner thread, with relaxed atomic stores so that reports can read them.
+ */
+struct ClosureStatsTable {
+    struct ClosureStatsTable *next;
+    struct ClosureStatsTable *previous;
+    size_t used;
+    struct ClosureStats slots[CLOSURE_STATS_SLOTS];
+};
+
+/*
+ * Classes not fitting the thread table are accounted to this one.
+ */
+static const struct ClosureClass ClosureInstrumentation_overflowClass = {.name="(other)"};
+
+bool __ClosureInstrumentation_enabled = false;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct ClosureStatsTable *tables = NULL;
+static struct ClosureStatsTable retired;
+static __thread struct ClosureStatsTable *table = NULL;
+
+static void ClosureStats_add(struct ClosureStats *self, const struct ClosureStats *other);
+
+static struct ClosureStats *ClosureStatsTable_lookup(struct ClosureStatsTable *self, const struct ClosureClass *class);
+
+static void ClosureInstrumentation_init(void);
+
+static void ClosureInstrumentation_retire(void *table);
+
+static struct ClosureStatsTable *ClosureInstrumentation_table(void);
+
+#endif
+
+/*
+ * IMPLEMENTATION
+ */
+#if defined(CLOSURE_INSTRUMENTATION)
+
+void ClosureStats_add(struct ClosureStats *const self, const struct ClosureStats *const other) {
+    self->calls += __atomic_load_n(&other->calls, __ATOMIC_RELAXED);
+    self->errors += __atomic_load_n(&other->errors, __ATOMIC_RELAXED);
+    self->nanoseconds += __atomic_load_n(&other->nanoseconds, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < CLOSURE_STATS_BUCKETS; i++) {
+        self->histogram[i] += __atomic_load_n(&other->histogram[i], __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Returns the slot of class, claiming it if needed, or the overflow slot if the table is full: the last free slot is
+ * reserved to the overflow class. Only the owner thread claims slots, other threads may read them concurrently.
+ */
+struct ClosureStats *ClosureStatsTable_lookup(struct ClosureStatsTable *const self,
+                                              const struct ClosureClass *const class) {
+    const size_t hash = ((uintptr_t) class >> 4u) * 0x9E3779B97F4A7C15u >> 32u;
+    for (size_t probe = 0; probe < CLOSURE_STATS_SLOTS; probe++) {
+        struct ClosureStats *slot = &self->slots[(hash + probe) & (CLOSURE_STATS_SLOTS - 1)];
+        const struct ClosureClass *owner = __atomic_load_n(&slot->class, __ATOMIC_RELAXED);
+        if (class == owner) {
+            return slot;
+        }
+        if (NULL == owner) {
+            if (self->used + 1 < CLOSURE_STATS_SLOTS || &ClosureInstrumentation_overflowClass == class) {
+                self->used++;
+                __atomic_store_n(&slot->class, class, __ATOMIC_RELEASE);
+                return slot;
+            }
+            break;
+        }
+    }
+    return ClosureStatsTable_lookup(self, &ClosureInstrumentation_overflowClass);
+}
+
+void ClosureInstrumentation_init(void) {
+    pthread_key_create(&key, ClosureInstrumentation_retire);
+}
+
+void ClosureInstrumentation_retire(void *const exiting) {
+    struct ClosureStatsTable *self = exiting;
+    pthread_mutex_lock(&mutex);
+    if (self->previous) {
+        self->previous->next = self->next;
+    } else {
+        tables = self->next;
+    }
+    if (self->next) {
+        self->next->previous = self->previous;
+    }
+    for (size_t i = 0; i < CLOSURE_STATS_SLOTS; i++) {
+        if (self->slots[i].class) {
+            ClosureStats_add(ClosureStatsTable_lookup(&retired, self->slots[i].class), &self->slots[i]);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    table = NULL;           // a later destructor may still call closures, a new table is then made
+    Alligator_free(self);
+}
+
+struct ClosureStatsTable *ClosureInstrumentation_table(void) {
+    if (NULL == table) {
+        pthread_once(&once, ClosureInstrumentation_init);
+        table = Option_unwrap(Alligator_calloc(1, sizeof(*table)));
+        pthread_setspecific(key, table);
+        pthread_mutex_lock(&mutex);
+        table->next = tables;
+        if (tables) {
+            tables->previous = table;
+        }
+        tables = table;
+        pthread_mutex_unlock(&mutex);
+    }
+    return table;
+}
+
+uint64_t __ClosureInstrumentation_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+void __ClosureInstrumentation_record(const struct ClosureClass *const class, const uint64_t calls,
+                                     const uint64_t errors, const uint64_t nanoseconds) {
+    assert(class);
+    assert(calls > 0);
+    struct ClosureStats *stats = ClosureStatsTable_lookup(ClosureInstrumentation_table(), class);
+    const uint64_t average = nanoseconds / calls;
+    size_t bucket = (0 == average) ? 0 : (size_t) (64 - __builtin_clzll(average));
+    if (bucket >= CLOSURE_STATS_BUCKETS) {
+        bucket = CLOSURE_STATS_BUCKETS - 1;
+    }
+    __atomic_store_n(&stats->calls, stats->calls + calls, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->errors, stats->errors + errors, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->nanoseconds, stats->nanoseconds + nanoseconds, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->histogram[bucket], stats->histogram[bucket] + calls, __ATOMIC_RELAXED);
+}
+
+#endif
+
+bool ClosureInstrumentation_isEnabled(void) {
+#if defined(CLOSURE_INSTRUMENTATION)
+    return __ClosureInstrumentation_isEnabled();
+#else
+    return false;
+#endif
+}
+
+void ClosureInstrumentation_setEnabled(const bool enabled) {
+#if defined(CLOSURE_INSTRUMENTATION)
+    __atomic_store_n(&__ClosureInstrumentation_enabled, enabled, __ATOMIC_RELAXED);
+#else
+    (void) enabled;
+#endif
+}
+
+void ClosureInstrumentation_forEach(void (*const f)(const struct ClosureStats *, void *), void *const context) {
+    assert(f);
+#if defined(CLOSURE_INSTRUMENTATION)
+    struct ClosureStatsTable *summary = Option_unwrap(Alligator_calloc(1, sizeof(*summary)));
+    pthread_mutex_lock(&mutex);
+    for (struct ClosureStatsTable *current = &retired; current; current = (current == &retired) ? tables : current->next) {
+        for (size_t i = 0; i < CLOSURE_STATS_SLOTS; i++) {
+            const struct ClosureClass *class = __atomic_load_n(&current->slots[i].class, __ATOMIC_ACQUIRE);
+            if (class) {
+                ClosureStats_add(ClosureStatsTable_lookup(summary, class), &current->slots[i]);
+            }
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    for (size_t i = 0; i < CLOSURE_STATS_SLOTS; i++) {
+        if (summary->slots[i].class) {
+            f(&summary->slots[i], context);
+        }
+    }
+    Alligator_free(summary);
+#else
+    (void) f;
+    (void) context;
+#endif
+}
+
+/*
+ * Returns the upper bound, in nanoseconds, of the bucket holding the given quantile of the calls.
+ */
+static uint64_t ClosureStats_quantile(const struct ClosureStats *const self, const double quantile) {
+    const uint64_t rank = (uint64_t) ((double) self->calls * quantile);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < CLOSURE_STATS_BUCKETS; i++) {
+        seen += self->histogram[i];
+        if (seen > rank) {
+            return (uint64_t) 1 << i;
+        }
+    }
+    return (uint64_t) 1 << (CLOSURE_STATS_BUCKETS - 1);
+}
+
+static void ClosureInstrumentation_dumpOne(const struct ClosureStats *const stats, void *const context) {
+    FILE *stream = context;
+    if (stats->class->name) {
+        fprintf(stream, "%-32s", stats->class->name);
+    } else {
+        fprintf(stream, "%-32p", (void *) (uintptr_t) stats->class->call);
+    }
+    fprintf(stream, " %12llu %10llu %12.1f %10llu %10llu\n",
+            (unsigned long long) stats->calls, (unsigned long long) stats->errors,
+            stats->calls ? (double) stats->nanoseconds / (double) stats->calls : 0.0,
+            (unsigned long long) ClosureStats_quantile(stats, 0.5),
+            (unsigned long long) ClosureStats_quantile(stats, 0.99));
+}
+
+void ClosureInstrumentation_dump(FILE *const stream) {
+    assert(stream);
+    fprintf(stream, "%-32s %12s %10s %12s %10s %10s\n", "class", "calls", "errors", "mean ns", "p50 ns <", "p99 ns <");
+    ClosureInstrumentation_forEach(ClosureInstrumentation_dumpOne, stream);
+}
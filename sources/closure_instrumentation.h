@@ -0,0 +1,107 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CLOSURE_STATS_BUCKETS   40
+
+/**
+ * Per class call statistics, recorded only if the library is built with `CLOSURE_INSTRUMENTATION` defined and the
+ * instrumentation is enabled at runtime with `ClosureInstrumentation_setEnabled`.
+ * Without `CLOSURE_INSTRUMENTATION` calls are not instrumented at all and there is nothing to report.
+ *
+ * Counters are kept per thread, so that recording does not need any synchronization, and are summed up on report.
+ */
+struct ClosureStats {
+    /** The class of the closures, the interned one for closures made of bare function pointers. */
+    const struct ClosureClass *class;
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t nanoseconds;
+    /** histogram[i] counts the calls that took less than 2^i nanoseconds and at least 2^(i-1). */
+    uint64_t histogram[CLOSURE_STATS_BUCKETS];
+};
+
+/**
+ * Returns `true` if calls are being instrumented.
+ */
+extern bool ClosureInstrumentation_isEnabled(void)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Starts or stops instrumenting calls, it has no effect if instrumentation has been compiled out.
+ */
+extern void ClosureInstrumentation_setEnabled(bool enabled);
+
+/**
+ * Calls f once for every class called so far, giving it the statistics summed up over all threads.
+ * Threads keep on recording meanwhile, so that statistics may be slightly behind.
+ */
+extern void ClosureInstrumentation_forEach(void (*f)(const struct ClosureStats *stats, void *context), void *context)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Prints a table of the statistics of every class called so far to stream.
+ */
+extern void ClosureInstrumentation_dump(FILE *stream)
+__attribute__((__nonnull__));
+
+#if defined(CLOSURE_INSTRUMENTATION)
+
+/*
+ * Private, used by closure.c
+ */
+extern bool __ClosureInstrumentation_enabled;
+
+extern uint64_t __ClosureInstrumentation_now(void)
+__attribute__((__warn_unused_result__));
+
+extern void __ClosureInstrumentation_record(const struct ClosureClass *class, uint64_t calls, uint64_t errors,
+                                            uint64_t nanoseconds)
+__attribute__((__nonnull__));
+
+#define __ClosureInstrumentation_isEnabled() \
+    __atomic_load_n(&__ClosureInstrumentation_enabled, __ATOMIC_RELAXED)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,142 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <sched.h>
+#include "closure_lazy.h"
+
+#define SPINS_BEFORE_YIELD  64
+
+enum ClosureLazyState {
+    ClosureLazyState_Pending, ClosureLazyState_Cloning, ClosureLazyState_Running, ClosureLazyState_Done
+};
+
+struct ClosureLazy {
+    int state;                  // enum ClosureLazyState, accessed atomically
+    struct Closure *closure;    // NULL once evaluated
+    Result result;
+    void (*deleteResult)(Result);
+};
+
+static Result ClosureLazy_callImpl(Option environment, Option arguments);
+
+static void ClosureLazy_deleteImpl(Option environment);
+
+static Option ClosureLazy_cloneImpl(Option environment, Option storage);
+
+static const struct ClosureClass ClosureLazy_class = {
+        .name="ClosureLazy",
+        .environmentSize=sizeof(struct ClosureLazy),
+        .call=ClosureLazy_callImpl,
+        .delete=ClosureLazy_deleteImpl,
+        .clone=ClosureLazy_cloneImpl,
+};
+
+/*
+ * IMPLEMENTATION
+ */
+struct Closure *ClosureLazy_new(struct Closure *const closure, void (*const deleteResult)(Result)) {
+    assert(closure);
+    const struct ClosureLazy environment = {
+            .state=ClosureLazyState_Pending,
+            .closure=closure,
+            .result=Result_error(IllegalState),
+            .deleteResult=deleteResult,
+    };
+    return Closure_newFromClass(&ClosureLazy_class, Option_some((void *) &environment));
+}
+
+bool ClosureLazy_isLazy(const struct Closure *const closure) {
+    assert(closure);
+    return &ClosureLazy_class == Closure_getClass(closure);
+}
+
+bool ClosureLazy_isEvaluated(struct Closure *const lazy) {
+    assert(lazy);
+    assert(ClosureLazy_isLazy(lazy));
+    const struct ClosureLazy *self = Option_unwrap(Closure_getEnvironment(lazy));
+    return ClosureLazyState_Done == __atomic_load_n(&self->state, __ATOMIC_ACQUIRE);
+}
+
+Result ClosureLazy_callImpl(Option environment, Option arguments) {
+    (void) arguments;
+    struct ClosureLazy *self = Option_unwrap(environment);
+    while (true) {
+        int state = __atomic_load_n(&self->state, __ATOMIC_ACQUIRE);
+        for (size_t spin = 0; ClosureLazyState_Cloning == state || ClosureLazyState_Running == state; spin++) {
+            // another thread is cloning or evaluating the thunk
+            if (SPINS_BEFORE_YIELD == spin) {
+                sched_yield();
+                spin = 0;
+            }
+            state = __atomic_load_n(&self->state, __ATOMIC_ACQUIRE);
+        }
+
+        if (ClosureLazyState_Done == state) {
+            return self->result;
+        }
+
+        // pending, possibly again after a clone: race to evaluate it
+        if (__atomic_compare_exchange_n(&self->state, &state, ClosureLazyState_Running, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            struct Closure *closure = self->closure;
+            self->result = Closure_call(closure);
+            self->closure = NULL;
+            Closure_delete(closure);
+            __atomic_store_n(&self->state, ClosureLazyState_Done, __ATOMIC_RELEASE);
+            return self->result;
+        }
+    }
+}
+
+void ClosureLazy_deleteImpl(Option environment) {
+    struct ClosureLazy *self = Option_unwrap(environment);
+    if (ClosureLazyState_Done == __atomic_load_n(&self->state, __ATOMIC_ACQUIRE)) {
+        if (self->deleteResult) {
+            self->deleteResult(self->result);
+        }
+    } else {
+        assert(ClosureLazyState_Pending == self->state);
+        Closure_delete(self->closure);
+    }
+}
+
+Option ClosureLazy_cloneImpl(Option environment, Option storage) {
+    struct ClosureLazy *self = Option_unwrap(environment);
+    int state = ClosureLazyState_Pending;
+    // holds the thunk while retaining closure, so that a concurrent evaluation waits instead of deleting it meanwhile
+    if (!__atomic_compare_exchange_n(&self->state, &state, ClosureLazyState_Cloning, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return None;
+    }
+    struct ClosureLazy *clone = Option_unwrap(storage);
+    *clone = *self;
+    clone->state = ClosureLazyState_Pending;
+    clone->closure = Closure_retain(self->closure);
+    __atomic_store_n(&self->state, ClosureLazyState_Pending, __ATOMIC_RELEASE);
+    return storage;
+}
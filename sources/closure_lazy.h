@@ -0,0 +1,69 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <result/result.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Wraps closure in a thunk: the first call evaluates closure exactly once, even if several threads call the thunk
+ * concurrently, and every later call returns the same cached `Result` on a lock-free path.
+ * Concurrent callers spin, yielding the processor, until the evaluation is completed.
+ * The thunk takes ownership of closure, that is deleted as soon as it has been evaluated so that its environment
+ * does not stay resident; arguments passed to the thunk are ignored, closure is always called without arguments.
+ * deleteResult, that may be `NULL`, releases the cached result when the thunk is deleted.
+ * `Closure_clone` of a thunk not yet evaluated returns a thunk sharing a reference to closure, each one evaluating it
+ * on its own; thunks being or already evaluated can't be cloned, as the cached result can't be copied.
+ */
+extern struct Closure *ClosureLazy_new(struct Closure *closure, void (*deleteResult)(Result))
+__attribute__((__warn_unused_result__, __nonnull__(1)));
+
+/**
+ * Returns `true` if closure has been created by `ClosureLazy_new`.
+ */
+extern bool ClosureLazy_isLazy(const struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns `true` if the thunk has already been evaluated.
+ */
+extern bool ClosureLazy_isEvaluated(struct Closure *lazy)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+#ifdef __cplusplus
+}
+#endif
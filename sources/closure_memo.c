@@ -0,0 +1,263 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <alligator/alligator.h>
+#include "closure_memo.h"
+
+#define NIL     SIZE_MAX
+
+/*
+ * Entries live in a single array allocated upfront; they are chained both in their hash bucket and in the recency
+ * list, using indexes rather than pointers.
+ */
+struct ClosureMemoEntry {
+    Option key;
+    Result value;
+    size_t hash;
+    size_t bucketNext;
+    size_t newer;
+    size_t older;
+};
+
+struct ClosureMemo {
+    struct Closure *closure;
+    struct ClosureMemoOptions options;
+    struct ClosureMemoStats stats;
+    struct ClosureMemoEntry *entries;
+    size_t *buckets;
+    size_t bucketsMask;
+    size_t size;
+    size_t newest;
+    size_t oldest;
+    pthread_mutex_t mutex;
+};
+
+static Result ClosureMemo_callImpl(Option environment, Option arguments);
+
+static void ClosureMemo_deleteImpl(Option environment);
+
+static const struct ClosureClass ClosureMemo_class = {
+        .name="ClosureMemo",
+        .call=ClosureMemo_callImpl,
+        .delete=ClosureMemo_deleteImpl,
+};
+
+/*
+ * IMPLEMENTATION
+ */
+struct Closure *ClosureMemo_new(struct Closure *const closure, const struct ClosureMemoOptions *const options) {
+    assert(closure);
+    assert(options);
+    assert(options->capacity > 0);
+    assert(options->hash);
+    assert(options->equals);
+    size_t buckets = 1;
+    while (buckets < options->capacity * 2) {
+        buckets <<= 1u;
+    }
+    struct ClosureMemo *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+    self->closure = closure;
+    self->options = *options;
+    self->stats = (struct ClosureMemoStats) {0};
+    self->entries = Option_unwrap(Alligator_malloc(options->capacity * sizeof(self->entries[0])));
+    self->buckets = Option_unwrap(Alligator_malloc(buckets * sizeof(self->buckets[0])));
+    self->bucketsMask = buckets - 1;
+    self->size = 0;
+    self->newest = NIL;
+    self->oldest = NIL;
+    for (size_t i = 0; i < buckets; i++) {
+        self->buckets[i] = NIL;
+    }
+    if (options->threadSafe) {
+        pthread_mutex_init(&self->mutex, NULL);
+    }
+    return Closure_newFromClass(&ClosureMemo_class, Option_some(self));
+}
+
+bool ClosureMemo_isMemo(const struct Closure *const closure) {
+    assert(closure);
+    return &ClosureMemo_class == Closure_getClass(closure);
+}
+
+struct ClosureMemoStats ClosureMemo_getStats(struct Closure *const memo) {
+    assert(memo);
+    assert(ClosureMemo_isMemo(memo));
+    struct ClosureMemo *self = Option_unwrap(Closure_getEnvironment(memo));
+    if (self->options.threadSafe) {
+        pthread_mutex_lock(&self->mutex);
+    }
+    const struct ClosureMemoStats stats = self->stats;
+    if (self->options.threadSafe) {
+        pthread_mutex_unlock(&self->mutex);
+    }
+    return stats;
+}
+
+static void ClosureMemo_unlink(struct ClosureMemo *const self, const size_t index) {
+    struct ClosureMemoEntry *entry = &self->entries[index];
+    if (NIL == entry->newer) {
+        self->newest = entry->older;
+    } else {
+        self->entries[entry->newer].older = entry->older;
+    }
+    if (NIL == entry->older) {
+        self->oldest = entry->newer;
+    } else {
+        self->entries[entry->older].newer = entry->newer;
+    }
+}
+
+static void ClosureMemo_pushNewest(struct ClosureMemo *const self, const size_t index) {
+    struct ClosureMemoEntry *entry = &self->entries[index];
+    entry->newer = NIL;
+    entry->older = self->newest;
+    if (NIL == self->newest) {
+        self->oldest = index;
+    } else {
+        self->entries[self->newest].newer = index;
+    }
+    self->newest = index;
+}
+
+static size_t ClosureMemo_find(struct ClosureMemo *const self, const Option arguments, const size_t hash) {
+    for (size_t i = self->buckets[hash & self->bucketsMask]; NIL != i; i = self->entries[i].bucketNext) {
+        const struct ClosureMemoEntry *entry = &self->entries[i];
+        if (hash == entry->hash && self->options.equals(entry->key, arguments)) {
+            return i;
+        }
+    }
+    return NIL;
+}
+
+/*
+ * Evicts the least recently used entry and returns its slot.
+ */
+static size_t ClosureMemo_evict(struct ClosureMemo *const self) {
+    const size_t index = self->oldest;
+    struct ClosureMemoEntry *entry = &self->entries[index];
+    size_t *link = &self->buckets[entry->hash & self->bucketsMask];
+    while (*link != index) {
+        link = &self->entries[*link].bucketNext;
+    }
+    *link = entry->bucketNext;
+    ClosureMemo_unlink(self, index);
+    if (self->options.deleteArguments) {
+        self->options.deleteArguments(entry->key);
+    }
+    if (self->options.deleteResult) {
+        self->options.deleteResult(entry->value);
+    }
+    self->stats.evictions++;
+    return index;
+}
+
+static void ClosureMemo_insert(struct ClosureMemo *const self, const Option arguments, const size_t hash,
+                               const Result value) {
+    const size_t index = (self->size < self->options.capacity) ? self->size++ : ClosureMemo_evict(self);
+    struct ClosureMemoEntry *entry = &self->entries[index];
+    entry->key = self->options.copyArguments ? self->options.copyArguments(arguments) : arguments;
+    entry->value = value;
+    entry->hash = hash;
+    entry->bucketNext = self->buckets[hash & self->bucketsMask];
+    self->buckets[hash & self->bucketsMask] = index;
+    ClosureMemo_pushNewest(self, index);
+}
+
+Result ClosureMemo_callImpl(Option environment, Option arguments) {
+    struct ClosureMemo *self = Option_unwrap(environment);
+    const bool threadSafe = self->options.threadSafe;
+    const size_t hash = self->options.hash(arguments);
+
+    if (threadSafe) {
+        pthread_mutex_lock(&self->mutex);
+    }
+    size_t index = ClosureMemo_find(self, arguments, hash);
+    if (NIL != index) {
+        self->stats.hits++;
+        if (index != self->newest) {
+            ClosureMemo_unlink(self, index);
+            ClosureMemo_pushNewest(self, index);
+        }
+        const Result result = self->options.copyResult ? self->options.copyResult(self->entries[index].value)
+                                                       : self->entries[index].value;
+        if (threadSafe) {
+            pthread_mutex_unlock(&self->mutex);
+        }
+        return result;
+    }
+    self->stats.misses++;
+    if (threadSafe) {
+        pthread_mutex_unlock(&self->mutex);
+    }
+
+    Result result = Closure_callWith(self->closure, arguments);
+    if (Result_isError(result)) {
+        return result;
+    }
+
+    if (threadSafe) {
+        pthread_mutex_lock(&self->mutex);
+        index = ClosureMemo_find(self, arguments, hash);    // another thread may have cached it meanwhile
+    }
+    if (NIL == index) {
+        ClosureMemo_insert(self, arguments, hash, result);
+    } else {
+        if (self->options.deleteResult) {
+            self->options.deleteResult(result);
+        }
+        result = self->entries[index].value;
+    }
+    if (self->options.copyResult) {
+        result = self->options.copyResult(result);
+    }
+    if (threadSafe) {
+        pthread_mutex_unlock(&self->mutex);
+    }
+    return result;
+}
+
+void ClosureMemo_deleteImpl(Option environment) {
+    struct ClosureMemo *self = Option_unwrap(environment);
+    for (size_t i = 0; i < self->size; i++) {
+        if (self->options.deleteArguments) {
+            self->options.deleteArguments(self->entries[i].key);
+        }
+        if (self->options.deleteResult) {
+            self->options.deleteResult(self->entries[i].value);
+        }
+    }
+    if (self->options.threadSafe) {
+        pthread_mutex_destroy(&self->mutex);
+    }
+    Closure_delete(self->closure);
+    Alligator_free(self->buckets);
+    Alligator_free(self->entries);
+    Alligator_free(self);
+}
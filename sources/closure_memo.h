@@ -0,0 +1,110 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <option/option.h>
+#include <result/result.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Configures a memoizing closure, only capacity, hash and equals are mandatory.
+ */
+struct ClosureMemoOptions {
+    /** The maximum number of results cached, once full the least recently used one is evicted. */
+    size_t capacity;
+    /** Whether the memo may be called concurrently by several threads. */
+    bool threadSafe;
+    /** Hashes the payload of the arguments. */
+    size_t (*hash)(Option arguments);
+    /** Compares the payloads of two arguments. */
+    bool (*equals)(Option a, Option b);
+    /**
+     * Copies the arguments to be kept as a cache key, may be `NULL` to keep the arguments as they are.
+     * WARNING: leave it `NULL` only if arguments carry their payload by value, e.g. integers, or point to memory that
+     * outlives the memo. Arguments baked into compound literals, like `AdderArguments_bake` in the adder example does,
+     * live on the stack of the caller: keys left pointing to them are compared against freed memory by later lookups.
+     */
+    Option (*copyArguments)(Option arguments);
+    /** Releases a cache key on eviction, may be `NULL`. */
+    void (*deleteArguments)(Option arguments);
+    /** Releases a cached result on eviction, may be `NULL`. */
+    void (*deleteResult)(Result result);
+    /**
+     * Copies a cached result, under the lock in thread-safe mode, to be returned to the caller that then owns it,
+     * may be `NULL` to return the cached results themselves.
+     */
+    Result (*copyResult)(Result result);
+};
+
+/**
+ * Memo counters.
+ */
+struct ClosureMemoStats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+};
+
+/**
+ * Wraps closure in a new closure caching the ok results of closure by arguments, errors are never cached.
+ * The memo takes ownership of closure, that is deleted along with the memo by `Closure_delete`.
+ * Keys are kept as they are unless options->copyArguments is set, see its warning about arguments living on the stack.
+ * Without options->copyResult, cached results are owned by the memo and remain valid until evicted: callers must
+ * not release them, and in thread-safe mode they must not own resources, as a concurrent miss may evict them at any
+ * time. With options->copyResult, callers get copies made before the lock is released and must release them.
+ * In thread-safe mode closure is called outside the lock, so that concurrent misses on the same arguments may call
+ * closure more than once, only the first result is cached and returned to every caller.
+ */
+extern struct Closure *ClosureMemo_new(struct Closure *closure, const struct ClosureMemoOptions *options)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns `true` if closure has been created by `ClosureMemo_new`.
+ */
+extern bool ClosureMemo_isMemo(const struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns the counters of a closure created by `ClosureMemo_new`.
+ */
+extern struct ClosureMemoStats ClosureMemo_getStats(struct Closure *memo)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,451 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <alligator/alligator.h>
+#include "closure_persistent_memo.h"
+
+#define MAGIC                   "CLOSMEMO"
+#define VERSION                 1u
+#define HEADER_SIZE             64
+#define ALIGNMENT               8
+#define INDEX_INITIAL_CAPACITY  1024
+#define ENCODING_BUFFER_SIZE    256
+#define FNV_OFFSET_BASIS        0xCBF29CE484222325u
+#define FNV_PRIME               0x100000001B3u
+
+/*
+ * The file starts with a header and goes on with records appended one after the other, each one aligned to 8 bytes.
+ * The checksum of a record covers its sizes, key and value: it is written last, so that records torn by a crash, as
+ * well as the zeroes past the last record, never match it.
+ */
+struct ClosurePersistentMemoHeader {
+    char magic[8];
+    uint32_t version;
+};
+
+struct ClosurePersistentMemoRecord {
+    uint64_t checksum;
+    uint32_t keySize;
+    uint32_t valueSize;
+    unsigned char bytes[];  // the key followed by the value
+};
+
+/*
+ * The index is an open addressing hash table of records, both mapped and spilled ones, rebuilt when opening the file.
+ */
+struct ClosurePersistentMemoSlot {
+    uint64_t hash;
+    const struct ClosurePersistentMemoRecord *record;
+};
+
+struct ClosurePersistentMemo {
+    struct Closure *closure;
+    struct ClosurePersistentMemoOptions options;
+    struct ClosurePersistentMemoStats stats;
+    int file;
+    unsigned char *mapping;
+    size_t length;
+    size_t end;     // the offset past the last record
+    struct ClosurePersistentMemoSlot *slots;
+    size_t slotsMask;
+    size_t size;
+    struct ClosurePersistentMemoRecord **spilled;
+    size_t spilledCapacity;
+    pthread_mutex_t mutex;
+};
+
+static Result ClosurePersistentMemo_callImpl(Option environment, Option arguments);
+
+static void ClosurePersistentMemo_deleteImpl(Option environment);
+
+static const struct ClosureClass ClosurePersistentMemo_class = {
+        .name="ClosurePersistentMemo",
+        .call=ClosurePersistentMemo_callImpl,
+        .delete=ClosurePersistentMemo_deleteImpl,
+};
+
+static uint64_t ClosurePersistentMemo_hash(uint64_t hash, const void *bytes, size_t size);
+
+static uint64_t ClosurePersistentMemoRecord_checksum(const struct ClosurePersistentMemoRecord *record);
+
+static size_t ClosurePersistentMemoRecord_size(size_t keySize, size_t valueSize);
+
+static Error ClosurePersistentMemo_open(struct ClosurePersistentMemo *self);
+
+static void ClosurePersistentMemo_recover(struct ClosurePersistentMemo *self);
+
+static const struct ClosurePersistentMemoRecord *
+ClosurePersistentMemo_find(const struct ClosurePersistentMemo *self, uint64_t hash, const void *key, size_t keySize);
+
+static void ClosurePersistentMemo_index(struct ClosurePersistentMemo *self, uint64_t hash,
+                                        const struct ClosurePersistentMemoRecord *record);
+
+static const struct ClosurePersistentMemoRecord *
+ClosurePersistentMemo_append(struct ClosurePersistentMemo *self, uint64_t hash, const void *key, size_t keySize,
+                             Result_Value value);
+
+/*
+ * IMPLEMENTATION
+ */
+Result ClosurePersistentMemo_new(struct Closure *const closure, const struct ClosurePersistentMemoOptions *const options) {
+    assert(closure);
+    assert(options);
+    assert(options->path);
+    assert(options->capacity > 0);
+    assert(options->encodeArguments);
+    assert(options->encodeResult);
+    assert(options->decodeResult);
+    struct ClosurePersistentMemo *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+    self->closure = closure;
+    self->options = *options;
+    self->stats = (struct ClosurePersistentMemoStats) {0};
+    self->file = -1;
+    self->mapping = NULL;
+    self->length = 0;
+    self->end = HEADER_SIZE;
+    self->slots = Option_unwrap(Alligator_calloc(INDEX_INITIAL_CAPACITY, sizeof(self->slots[0])));
+    self->slotsMask = INDEX_INITIAL_CAPACITY - 1;
+    self->size = 0;
+    self->spilled = NULL;
+    self->spilledCapacity = 0;
+    const Error error = ClosurePersistentMemo_open(self);
+    if (Ok != error) {
+        if (self->mapping) {
+            munmap(self->mapping, self->length);
+        }
+        if (self->file >= 0) {
+            close(self->file);
+        }
+        Alligator_free(self->slots);
+        Alligator_free(self);
+        return Result_error(error);
+    }
+    ClosurePersistentMemo_recover(self);
+    if (options->threadSafe) {
+        pthread_mutex_init(&self->mutex, NULL);
+    }
+    return Result_ok(Closure_newFromClass(&ClosurePersistentMemo_class, Option_some(self)));
+}
+
+bool ClosurePersistentMemo_isPersistentMemo(const struct Closure *const closure) {
+    assert(closure);
+    return &ClosurePersistentMemo_class == Closure_getClass(closure);
+}
+
+struct ClosurePersistentMemoStats ClosurePersistentMemo_getStats(struct Closure *const memo) {
+    assert(memo);
+    assert(ClosurePersistentMemo_isPersistentMemo(memo));
+    struct ClosurePersistentMemo *self = Option_unwrap(Closure_getEnvironment(memo));
+    if (self->options.threadSafe) {
+        pthread_mutex_lock(&self->mutex);
+    }
+    struct ClosurePersistentMemoStats stats = self->stats;
+    stats.bytes = self->end;
+    if (self->options.threadSafe) {
+        pthread_mutex_unlock(&self->mutex);
+    }
+    return stats;
+}
+
+Error ClosurePersistentMemo_sync(struct Closure *const memo) {
+    assert(memo);
+    assert(ClosurePersistentMemo_isPersistentMemo(memo));
+    struct ClosurePersistentMemo *self = Option_unwrap(Closure_getEnvironment(memo));
+    return 0 == msync(self->mapping, self->length, MS_SYNC) ? Ok : SystemError;
+}
+
+Result ClosurePersistentMemo_callImpl(Option environment, Option arguments) {
+    struct ClosurePersistentMemo *self = Option_unwrap(environment);
+    const bool threadSafe = self->options.threadSafe;
+
+    unsigned char buffer[ENCODING_BUFFER_SIZE];
+    unsigned char *key = buffer;
+    const size_t keySize = self->options.encodeArguments(arguments, buffer, sizeof(buffer));
+    if (keySize > sizeof(buffer)) {
+        key = Option_unwrap(Alligator_malloc(keySize));
+        const size_t encodedSize = self->options.encodeArguments(arguments, key, keySize);
+        assert(encodedSize == keySize);
+        (void) encodedSize;
+    }
+    assert(keySize <= UINT32_MAX);
+    const uint64_t hash = ClosurePersistentMemo_hash(FNV_OFFSET_BASIS, key, keySize);
+
+    if (threadSafe) {
+        pthread_mutex_lock(&self->mutex);
+    }
+    const struct ClosurePersistentMemoRecord *record = ClosurePersistentMemo_find(self, hash, key, keySize);
+    if (record) {
+        self->stats.hits++;
+    } else {
+        self->stats.misses++;
+    }
+    if (threadSafe) {
+        pthread_mutex_unlock(&self->mutex);
+    }
+
+    if (NULL == record) {
+        const Result result = Closure_callWith(self->closure, arguments);
+        if (Result_isError(result)) {
+            if (key != buffer) {
+                Alligator_free(key);
+            }
+            return result;
+        }
+        if (threadSafe) {
+            pthread_mutex_lock(&self->mutex);
+            record = ClosurePersistentMemo_find(self, hash, key, keySize);  // another thread may have cached it meanwhile
+        }
+        if (NULL == record) {
+            record = ClosurePersistentMemo_append(self, hash, key, keySize, Result_unwrap(result));
+        }
+        if (threadSafe) {
+            pthread_mutex_unlock(&self->mutex);
+        }
+        if (self->options.deleteResult) {
+            self->options.deleteResult(result);
+        }
+    }
+    if (key != buffer) {
+        Alligator_free(key);
+    }
+    // records are never modified once indexed: decoding needs no lock
+    return self->options.decodeResult(record->bytes + record->keySize, record->valueSize);
+}
+
+void ClosurePersistentMemo_deleteImpl(Option environment) {
+    struct ClosurePersistentMemo *self = Option_unwrap(environment);
+    for (size_t i = 0; i < self->stats.spilled; i++) {
+        Alligator_free(self->spilled[i]);
+    }
+    if (self->options.threadSafe) {
+        pthread_mutex_destroy(&self->mutex);
+    }
+    Closure_delete(self->closure);
+    munmap(self->mapping, self->length);
+    close(self->file);  // releases the lock on the file too
+    Alligator_free(self->spilled);
+    Alligator_free(self->slots);
+    Alligator_free(self);
+}
+
+/*
+ * FNV-1a, both for hashing keys and for checksumming records.
+ */
+uint64_t ClosurePersistentMemo_hash(uint64_t hash, const void *const bytes, const size_t size) {
+    const unsigned char *byte = bytes;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ byte[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t ClosurePersistentMemoRecord_checksum(const struct ClosurePersistentMemoRecord *const record) {
+    uint64_t checksum = ClosurePersistentMemo_hash(FNV_OFFSET_BASIS, &record->keySize, sizeof(record->keySize));
+    checksum = ClosurePersistentMemo_hash(checksum, &record->valueSize, sizeof(record->valueSize));
+    return ClosurePersistentMemo_hash(checksum, record->bytes, (size_t) record->keySize + record->valueSize);
+}
+
+size_t ClosurePersistentMemoRecord_size(const size_t keySize, const size_t valueSize) {
+    const size_t size = sizeof(struct ClosurePersistentMemoRecord) + keySize + valueSize;
+    return (size + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1);
+}
+
+/*
+ * Opens, locks and maps the file, writing the header if the file is new.
+ * Files that are not empty are checked before being touched at all, so that a file refused with DomainError is left as
+ * it was; new files get their header on disk before being grown, so that a crash can't leave a zeroed header behind.
+ */
+Error ClosurePersistentMemo_open(struct ClosurePersistentMemo *const self) {
+    self->file = open(self->options.path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (self->file < 0) {
+        return SystemError;
+    }
+    if (0 != flock(self->file, LOCK_EX | LOCK_NB)) {
+        return IllegalState;
+    }
+    struct stat status;
+    if (0 != fstat(self->file, &status)) {
+        return SystemError;
+    }
+    const size_t fileSize = (size_t) status.st_size;
+    union {
+        struct ClosurePersistentMemoHeader header;
+        char bytes[HEADER_SIZE];
+    } header = {.bytes={0}};
+    if (0 == fileSize) {
+        memcpy(header.header.magic, MAGIC, sizeof(header.header.magic));
+        header.header.version = VERSION;
+        if (HEADER_SIZE != pwrite(self->file, header.bytes, HEADER_SIZE, 0) || 0 != fdatasync(self->file)) {
+            return SystemError;
+        }
+    } else if (fileSize < HEADER_SIZE) {
+        return DomainError;
+    } else if (HEADER_SIZE != pread(self->file, header.bytes, HEADER_SIZE, 0)) {
+        return SystemError;
+    } else if (0 != memcmp(header.header.magic, MAGIC, sizeof(header.header.magic)) ||
+               VERSION != header.header.version) {
+        return DomainError;
+    }
+
+    const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t length = fileSize > self->options.capacity ? fileSize : self->options.capacity;
+    length = (length < HEADER_SIZE ? HEADER_SIZE : length);
+    length = (length + pageSize - 1) / pageSize * pageSize;
+    // the file is grown at once: unused pages are sparse and appending never has to remap it
+    if (fileSize < length && 0 != ftruncate(self->file, (off_t) length)) {
+        return SystemError;
+    }
+    void *mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, self->file, 0);
+    if (MAP_FAILED == mapping) {
+        return SystemError;
+    }
+    self->mapping = mapping;
+    self->length = length;
+    return Ok;
+}
+
+/*
+ * Indexes the records of the file up to the first one whose checksum doesn't match, the next one is appended there.
+ * Keys recorded more than once, e.g. by concurrent misses before a crash, resolve to the first record.
+ */
+void ClosurePersistentMemo_recover(struct ClosurePersistentMemo *const self) {
+    size_t offset = HEADER_SIZE;
+    while (offset + sizeof(struct ClosurePersistentMemoRecord) <= self->length) {
+        const struct ClosurePersistentMemoRecord *record =
+                (const struct ClosurePersistentMemoRecord *) (self->mapping + offset);
+        const size_t available = self->length - offset - sizeof(*record);
+        if ((size_t) record->keySize > available || (size_t) record->valueSize > available - record->keySize ||
+            record->checksum != ClosurePersistentMemoRecord_checksum(record)) {
+            break;
+        }
+        const uint64_t hash = ClosurePersistentMemo_hash(FNV_OFFSET_BASIS, record->bytes, record->keySize);
+        if (NULL == ClosurePersistentMemo_find(self, hash, record->bytes, record->keySize)) {
+            ClosurePersistentMemo_index(self, hash, record);
+            self->stats.recovered++;
+        }
+        offset += ClosurePersistentMemoRecord_size(record->keySize, record->valueSize);
+    }
+    self->end = offset < self->length ? offset : self->length;
+}
+
+const struct ClosurePersistentMemoRecord *
+ClosurePersistentMemo_find(const struct ClosurePersistentMemo *const self, const uint64_t hash,
+                           const void *const key, const size_t keySize) {
+    for (size_t i = (size_t) hash & self->slotsMask; self->slots[i].record; i = (i + 1) & self->slotsMask) {
+        const struct ClosurePersistentMemoSlot *slot = &self->slots[i];
+        if (hash == slot->hash && keySize == slot->record->keySize &&
+            0 == memcmp(slot->record->bytes, key, keySize)) {
+            return slot->record;
+        }
+    }
+    return NULL;
+}
+
+void ClosurePersistentMemo_index(struct ClosurePersistentMemo *const self, const uint64_t hash,
+                                 const struct ClosurePersistentMemoRecord *const record) {
+    if (2 * (self->size + 1) > self->slotsMask + 1) {
+        const struct ClosurePersistentMemoSlot *slots = self->slots;
+        const size_t capacity = self->slotsMask + 1;
+        self->slots = Option_unwrap(Alligator_calloc(capacity * 2, sizeof(self->slots[0])));
+        self->slotsMask = capacity * 2 - 1;
+        for (size_t i = 0; i < capacity; i++) {
+            if (slots[i].record) {
+                size_t k = (size_t) slots[i].hash & self->slotsMask;
+                while (self->slots[k].record) {
+                    k = (k + 1) & self->slotsMask;
+                }
+                self->slots[k] = slots[i];
+            }
+        }
+        Alligator_free((void *) slots);
+    }
+    size_t i = (size_t) hash & self->slotsMask;
+    while (self->slots[i].record) {
+        i = (i + 1) & self->slotsMask;
+    }
+    self->slots[i] = (struct ClosurePersistentMemoSlot) {.hash=hash, .record=record};
+    self->size++;
+}
+
+/*
+ * Encodes the value straight into the file past the last record, or in memory if it doesn't fit, then publishes the
+ * record by writing its checksum.
+ */
+const struct ClosurePersistentMemoRecord *
+ClosurePersistentMemo_append(struct ClosurePersistentMemo *const self, const uint64_t hash, const void *const key,
+                             const size_t keySize, const Result_Value value) {
+    struct ClosurePersistentMemoRecord *record = NULL;
+    size_t available = 0;
+    if (self->end + sizeof(*record) + keySize <= self->length && keySize <= UINT32_MAX) {
+        record = (struct ClosurePersistentMemoRecord *) (self->mapping + self->end);
+        available = self->length - self->end - sizeof(*record) - keySize;
+    }
+    const size_t valueSize = self->options.encodeResult(value, record ? record->bytes + keySize : NULL,
+                                                        record ? available : 0);
+    if (record && valueSize <= available && valueSize <= UINT32_MAX) {
+        memcpy(record->bytes, key, keySize);
+        record->keySize = (uint32_t) keySize;
+        record->valueSize = (uint32_t) valueSize;
+        const uint64_t checksum = ClosurePersistentMemoRecord_checksum(record);
+        __atomic_store_n(&record->checksum, checksum, __ATOMIC_RELEASE);
+        const size_t size = ClosurePersistentMemoRecord_size(keySize, valueSize);
+        if (self->options.sync) {
+            const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+            const size_t start = self->end / pageSize * pageSize;
+            if (0 != msync(self->mapping + start, self->end + size - start, MS_SYNC)) {
+                self->stats.syncFailures++;
+            }
+        }
+        self->end += size;
+    } else {
+        record = Option_unwrap(Alligator_malloc(sizeof(*record) + keySize + valueSize));
+        memcpy(record->bytes, key, keySize);
+        const size_t encodedSize = self->options.encodeResult(value, record->bytes + keySize, valueSize);
+        assert(encodedSize == valueSize);
+        (void) encodedSize;
+        record->keySize = (uint32_t) keySize;
+        record->valueSize = (uint32_t) valueSize;
+        record->checksum = 0;
+        if (self->stats.spilled == self->spilledCapacity) {
+            self->spilledCapacity = self->spilledCapacity ? self->spilledCapacity * 2 : 16;
+            self->spilled = Option_unwrap(
+                    Alligator_realloc(self->spilled, self->spilledCapacity * sizeof(self->spilled[0])));
+        }
+        self->spilled[self->stats.spilled++] = record;
+    }
+    ClosurePersistentMemo_index(self, hash, record);
+    return record;
+}
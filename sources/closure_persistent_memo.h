@@ -0,0 +1,125 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <option/option.h>
+#include <result/result.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Configures a persistent memoizing closure, every field but threadSafe, sync and deleteResult is mandatory.
+ *
+ * Encoders write the bytes of their input in buffer only if they fit in size, and return the number of bytes needed
+ * in any case: they may be called with a buffer too small, and are then called again with a large enough one.
+ */
+struct ClosurePersistentMemoOptions {
+    /** The path of the cache file, created if missing. */
+    const char *path;
+    /** The number of bytes of the cache file, it is mapped in memory once and never grows past them. */
+    size_t capacity;
+    /** Whether the memo may be called concurrently by several threads. */
+    bool threadSafe;
+    /** Whether every entry appended is flushed to disk before returning, so that it survives power losses too. */
+    bool sync;
+    /** Serialises the arguments into the bytes of a cache key. */
+    size_t (*encodeArguments)(Option arguments, void *buffer, size_t size);
+    /** Serialises the value of an ok result of the wrapped closure into the bytes of a cached value. */
+    size_t (*encodeResult)(Result_Value value, void *buffer, size_t size);
+    /** Turns the bytes of a cached value into the result returned by the memo, bytes remain valid along the memo. */
+    Result (*decodeResult)(const void *bytes, size_t size);
+    /** Releases a result of the wrapped closure once encoded, may be `NULL`. */
+    void (*deleteResult)(Result result);
+};
+
+/**
+ * Persistent memo counters.
+ */
+struct ClosurePersistentMemoStats {
+    /** The number of entries recovered from the cache file when opened. */
+    size_t recovered;
+    size_t hits;
+    size_t misses;
+    /** The number of entries kept in memory only because the cache file was full. */
+    size_t spilled;
+    /** The number of bytes of the cache file in use. */
+    size_t bytes;
+    /** The number of entries appended in sync mode that could not be flushed to disk. */
+    size_t syncFailures;
+};
+
+/**
+ * Wraps closure in a new closure caching the ok results of closure, by the bytes of the arguments, in an append-only
+ * log of checksummed entries stored in the memory-mapped file at options->path, errors are never cached.
+ * Opening the file again, e.g. after a restart, rebuilds the index of the entries in it, stopping at the first entry
+ * torn by a crash, so that the cache is warm from the first call.
+ *
+ * Results are always made by options->decodeResult out of bytes stored in the file, without copying them, remain valid
+ * until the memo is deleted and must not be released by callers. Once the file is full new entries are kept in memory
+ * and are lost when the memo is deleted.
+ *
+ * On success the memo takes ownership of closure, deleted along with the memo by `Closure_delete`, otherwise the
+ * caller keeps it and the error is either `SystemError`, if the file can't be opened or mapped, `IllegalState`, if
+ * the file is already in use by another memo, or `DomainError`, if the file is neither empty nor a cache file, in
+ * which case it is left untouched.
+ */
+extern ResultOf(struct Closure *, SystemError, IllegalState, DomainError)
+ClosurePersistentMemo_new(struct Closure *closure, const struct ClosurePersistentMemoOptions *options)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns `true` if closure has been created by `ClosurePersistentMemo_new`.
+ */
+extern bool ClosurePersistentMemo_isPersistentMemo(const struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns the counters of a closure created by `ClosurePersistentMemo_new`.
+ */
+extern struct ClosurePersistentMemoStats ClosurePersistentMemo_getStats(struct Closure *memo)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Flushes to disk the entries appended to the cache file of a closure created by `ClosurePersistentMemo_new`.
+ * Returns `Ok` on success, `SystemError` otherwise.
+ */
+extern Error ClosurePersistentMemo_sync(struct Closure *memo)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+#ifdef __cplusplus
+}
+#endif
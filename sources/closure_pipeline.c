@@ -0,0 +1,346 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <sched.h>
+#include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <alligator/alligator.h>
+#include "closure_aligned.h"
+#include "closure_pipeline.h"
+
+#define BATCH                   64
+#define SPINS_BEFORE_PARKING    128
+
+/*
+ * A bounded single-producer single-consumer ring: head is written only by the consumer and tail only by the producer,
+ * each one on its own cache line along with the cached view of the index of the other side, so that the shared
+ * indexes are read only when the cached ones say that the ring looks empty or full.
+ * A side that finds the ring empty, or full, spins for a while and then parks on the condition until woken up.
+ */
+struct ClosurePipelineRing {
+    size_t head __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    size_t tailCache;
+    size_t tail __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    size_t headCache;
+    bool closed;
+    unsigned waiting __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    size_t mask;
+    Result *slots;
+} __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+
+struct ClosurePipelineStage {
+    struct Closure *closure;
+    struct ClosurePipelineRing *input;
+    struct ClosurePipelineRing *output;
+    pthread_t thread;
+};
+
+struct ClosurePipeline {
+    struct ClosurePipelineStage *stages;
+    size_t length;
+    struct ClosurePipelineRing *rings;      // length + 1 rings: push feeds the first one, each stage the next one
+    void *ringsAllocation;                  // the allocation rings are aligned within, to be freed
+    size_t capacity;
+    size_t started;
+    bool closed;
+};
+
+static void ClosurePipelineRing_init(struct ClosurePipelineRing *ring, size_t capacity);
+
+static void ClosurePipelineRing_destroy(struct ClosurePipelineRing *ring);
+
+static void ClosurePipelineRing_write(struct ClosurePipelineRing *ring, const Result *items, size_t n);
+
+static size_t ClosurePipelineRing_read(struct ClosurePipelineRing *ring, Result *items, size_t n);
+
+static void ClosurePipelineRing_close(struct ClosurePipelineRing *ring);
+
+static void *ClosurePipelineStage_run(void *argument);
+
+/*
+ * IMPLEMENTATION
+ */
+struct ClosurePipeline *ClosurePipeline_new(const size_t capacity) {
+    assert(capacity > 0);
+    struct ClosurePipeline *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+    self->stages = NULL;
+    self->length = 0;
+    self->rings = NULL;
+    self->capacity = 1;
+    while (self->capacity < capacity) {
+        self->capacity <<= 1u;
+    }
+    self->started = 0;
+    self->closed = false;
+    return self;
+}
+
+void ClosurePipeline_addStage(struct ClosurePipeline *const self, struct Closure *const stage) {
+    assert(self);
+    assert(stage);
+    assert(NULL == self->rings);
+    self->stages = Option_unwrap(Alligator_realloc(self->stages, (self->length + 1) * sizeof(self->stages[0])));
+    self->stages[self->length++] = (struct ClosurePipelineStage) {.closure=stage};
+}
+
+bool ClosurePipeline_start(struct ClosurePipeline *const self) {
+    assert(self);
+    assert(NULL == self->rings);
+    self->rings = __Closure_allocateAligned((self->length + 1) * sizeof(self->rings[0]), &self->ringsAllocation);
+    for (size_t i = 0; i <= self->length; i++) {
+        ClosurePipelineRing_init(&self->rings[i], self->capacity);
+    }
+    for (size_t i = 0; i < self->length; i++) {
+        struct ClosurePipelineStage *stage = &self->stages[i];
+        stage->input = &self->rings[i];
+        stage->output = &self->rings[i + 1];
+        if (0 != pthread_create(&stage->thread, NULL, ClosurePipelineStage_run, stage)) {
+            // the stages started so far are stopped by delete, draining the output of the last one of them
+            return false;
+        }
+        self->started++;
+    }
+    return true;
+}
+
+void ClosurePipeline_push(struct ClosurePipeline *const self, const Result_Value value) {
+    assert(self);
+    assert(self->rings);
+    assert(!self->closed);
+    const Result item = Result_ok(value);
+    ClosurePipelineRing_write(&self->rings[0], &item, 1);
+}
+
+void ClosurePipeline_pushBatch(struct ClosurePipeline *const self, const Result_Value *const values, const size_t n) {
+    assert(self);
+    assert(self->rings);
+    assert(!self->closed);
+    assert(values);
+    Result items[BATCH];
+    for (size_t i = 0; i < n; i += BATCH) {
+        const size_t chunk = n - i < BATCH ? n - i : BATCH;
+        for (size_t k = 0; k < chunk; k++) {
+            items[k] = Result_ok(values[i + k]);
+        }
+        ClosurePipelineRing_write(&self->rings[0], items, chunk);
+    }
+}
+
+bool ClosurePipeline_pop(struct ClosurePipeline *const self, Result *const out) {
+    assert(self);
+    assert(self->rings);
+    assert(out);
+    return 1 == ClosurePipelineRing_read(&self->rings[self->length], out, 1);
+}
+
+size_t ClosurePipeline_popBatch(struct ClosurePipeline *const self, Result *const out, const size_t n) {
+    assert(self);
+    assert(self->rings);
+    assert(out);
+    return n > 0 ? ClosurePipelineRing_read(&self->rings[self->length], out, n) : 0;
+}
+
+void ClosurePipeline_close(struct ClosurePipeline *const self) {
+    assert(self);
+    assert(self->rings);
+    if (!self->closed) {
+        self->closed = true;
+        ClosurePipelineRing_close(&self->rings[0]);
+    }
+}
+
+void ClosurePipeline_delete(struct ClosurePipeline *const self) {
+    if (self) {
+        if (self->rings) {
+            ClosurePipeline_close(self);
+            // closing the first ring stops the stages one after the other, once each one has drained its input
+            Result discarded[BATCH];
+            while (ClosurePipelineRing_read(&self->rings[self->started], discarded, BATCH) > 0) {
+            }
+            for (size_t i = 0; i < self->started; i++) {
+                pthread_join(self->stages[i].thread, NULL);
+            }
+            for (size_t i = 0; i <= self->length; i++) {
+                ClosurePipelineRing_destroy(&self->rings[i]);
+            }
+            Alligator_free(self->ringsAllocation);
+        }
+        for (size_t i = 0; i < self->length; i++) {
+            Closure_delete(self->stages[i].closure);
+        }
+        Alligator_free(self->stages);
+        Alligator_free(self);
+    }
+}
+
+/*
+ * Stages
+ */
+void *ClosurePipelineStage_run(void *const argument) {
+    struct ClosurePipelineStage *stage = argument;
+    Result items[BATCH];
+    size_t n;
+    while ((n = ClosurePipelineRing_read(stage->input, items, BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (Result_isOk(items[i])) {
+                items[i] = Closure_callWith(stage->closure, Option_some(Result_unwrap(items[i])));
+            }
+        }
+        ClosurePipelineRing_write(stage->output, items, n);
+    }
+    ClosurePipelineRing_close(stage->output);
+    return NULL;
+}
+
+/*
+ * Rings
+ */
+void ClosurePipelineRing_init(struct ClosurePipelineRing *const ring, const size_t capacity) {
+    assert(ring);
+    assert(capacity > 0 && 0 == (capacity & (capacity - 1)));
+    ring->head = 0;
+    ring->tailCache = 0;
+    ring->tail = 0;
+    ring->headCache = 0;
+    ring->closed = false;
+    ring->waiting = 0;
+    pthread_mutex_init(&ring->mutex, NULL);
+    pthread_cond_init(&ring->condition, NULL);
+    ring->mask = capacity - 1;
+    ring->slots = Option_unwrap(Alligator_malloc(capacity * sizeof(ring->slots[0])));
+}
+
+void ClosurePipelineRing_destroy(struct ClosurePipelineRing *const ring) {
+    assert(ring);
+    pthread_cond_destroy(&ring->condition);
+    pthread_mutex_destroy(&ring->mutex);
+    Alligator_free(ring->slots);
+}
+
+static bool ClosurePipelineRing_canWrite(struct ClosurePipelineRing *const ring) {
+    return __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) - __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) <=
+           ring->mask;
+}
+
+static bool ClosurePipelineRing_canRead(struct ClosurePipelineRing *const ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_RELAXED) != __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) ||
+           __atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Indexes are published with sequentially consistent stores, and waiting is read after them, so that either the
+ * side publishing sees the other one parked or the other one sees the index before parking.
+ */
+static void ClosurePipelineRing_wait(struct ClosurePipelineRing *const ring,
+                                     bool (*const ready)(struct ClosurePipelineRing *)) {
+    for (size_t spin = 0; spin < SPINS_BEFORE_PARKING; spin++) {
+        if (ready(ring)) {
+            return;
+        }
+        sched_yield();
+    }
+    pthread_mutex_lock(&ring->mutex);
+    __atomic_fetch_add(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+    while (!ready(ring)) {
+        pthread_cond_wait(&ring->condition, &ring->mutex);
+    }
+    __atomic_fetch_sub(&ring->waiting, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&ring->mutex);
+}
+
+static void ClosurePipelineRing_wake(struct ClosurePipelineRing *const ring) {
+    if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&ring->mutex);
+        pthread_cond_broadcast(&ring->condition);
+        pthread_mutex_unlock(&ring->mutex);
+    }
+}
+
+void ClosurePipelineRing_write(struct ClosurePipelineRing *const ring, const Result *const items, const size_t n) {
+    assert(ring);
+    assert(items);
+    const size_t capacity = ring->mask + 1;
+    size_t written = 0;
+    while (written < n) {
+        const size_t tail = ring->tail;
+        size_t room = capacity - (tail - ring->headCache);
+        if (0 == room) {
+            ring->headCache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            room = capacity - (tail - ring->headCache);
+            if (0 == room) {
+                ClosurePipelineRing_wait(ring, ClosurePipelineRing_canWrite);
+                continue;
+            }
+        }
+        const size_t chunk = n - written < room ? n - written : room;
+        for (size_t i = 0; i < chunk; i++) {
+            ring->slots[(tail + i) & ring->mask] = items[written + i];
+        }
+        __atomic_store_n(&ring->tail, tail + chunk, __ATOMIC_SEQ_CST);
+        written += chunk;
+        ClosurePipelineRing_wake(ring);
+    }
+}
+
+size_t ClosurePipelineRing_read(struct ClosurePipelineRing *const ring, Result *const items, const size_t n) {
+    assert(ring);
+    assert(items);
+    while (true) {
+        const size_t head = ring->head;
+        size_t available = ring->tailCache - head;
+        if (0 == available) {
+            ring->tailCache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+            available = ring->tailCache - head;
+        }
+        if (available > 0) {
+            const size_t chunk = n < available ? n : available;
+            for (size_t i = 0; i < chunk; i++) {
+                items[i] = ring->slots[(head + i) & ring->mask];
+            }
+            __atomic_store_n(&ring->head, head + chunk, __ATOMIC_SEQ_CST);
+            ClosurePipelineRing_wake(ring);
+            return chunk;
+        }
+        if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+            // closed is set after the last value has been published
+            if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+                return 0;
+            }
+            continue;
+        }
+        ClosurePipelineRing_wait(ring, ClosurePipelineRing_canRead);
+    }
+}
+
+void ClosurePipelineRing_close(struct ClosurePipelineRing *const ring) {
+    assert(ring);
+    __atomic_store_n(&ring->closed, true, __ATOMIC_SEQ_CST);
+    ClosurePipelineRing_wake(ring);
+}
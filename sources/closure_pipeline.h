@@ -0,0 +1,118 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <result/result.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A chain of closures, the stages, each one running on its own thread and connected to the next one by a bounded
+ * lock-free single-producer single-consumer ring.
+ * Values pushed in the pipeline flow through the stages in order: each stage is called with `Option_some` of the value
+ * of the result of the previous stage, errors skip the remaining stages, and the results of the last stage are popped
+ * out of the pipeline. Stages hand off values in batches, and a full ring blocks the stage, or the producer, feeding it.
+ *
+ * Values must be pushed by one thread at a time and popped by one thread at a time, which may be a different one.
+ */
+struct ClosurePipeline;
+
+/**
+ * Creates an empty pipeline whose rings hold capacity values each, rounded up to a power of 2.
+ */
+extern struct ClosurePipeline *ClosurePipeline_new(size_t capacity)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Appends stage to this pipeline taking ownership of the given reference.
+ *
+ * @attention must be called before `ClosurePipeline_start`.
+ */
+extern void ClosurePipeline_addStage(struct ClosurePipeline *self, struct Closure *stage)
+__attribute__((__nonnull__));
+
+/**
+ * Starts a thread for each stage, returns `false` if the threads can't be started.
+ */
+extern bool ClosurePipeline_start(struct ClosurePipeline *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Pushes value in this pipeline, waiting for room if the first ring is full.
+ *
+ * @attention must not be called after `ClosurePipeline_close`.
+ */
+extern void ClosurePipeline_push(struct ClosurePipeline *self, Result_Value value)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Pushes the n values in this pipeline, handing them off in batches.
+ *
+ * @attention must not be called after `ClosurePipeline_close`.
+ */
+extern void ClosurePipeline_pushBatch(struct ClosurePipeline *self, const Result_Value *values, size_t n)
+__attribute__((__nonnull__));
+
+/**
+ * Waits for the next result of the last stage and stores it in out.
+ * Returns `false` once the pipeline has been closed and every value pushed has been popped.
+ */
+extern bool ClosurePipeline_pop(struct ClosurePipeline *self, Result *out)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Waits for results of the last stage storing at most n of them in out, and returns the number of results stored.
+ * Returns 0 once the pipeline has been closed and every value pushed has been popped.
+ */
+extern size_t ClosurePipeline_popBatch(struct ClosurePipeline *self, Result *out, size_t n)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Signals that no more values will be pushed: stages finish once they have processed every value already pushed.
+ */
+extern void ClosurePipeline_close(struct ClosurePipeline *self)
+__attribute__((__nonnull__));
+
+/**
+ * Closes this pipeline if needed, discards the results not yet popped, waits for the stages to finish and deletes
+ * the pipeline along with its stages.
+ */
+extern void ClosurePipeline_delete(struct ClosurePipeline *self);
+
+#ifdef __cplusplus
+}
+#endif
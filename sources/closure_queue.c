@@ -0,0 +1,326 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <alligator/alligator.h>
+#include "closure_aligned.h"
+#include "closure_queue.h"
+
+#if defined(__linux__)
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define SPINS_BEFORE_SLEEP  64
+
+/*
+ * ClosureQueueEvent: an event count, waiters set the sleeping bit, check their condition once more and sleep until the
+ * word changes, notifiers bump the epoch and clear the bit, waking up every sleeper, only if the bit is set: once woken
+ * up, the sleepers cost no further system calls until they go back to sleep.
+ */
+struct ClosureQueueEvent {
+    unsigned word;      // the epoch shifted left by one, the lowest bit is set while someone may be sleeping
+#if !defined(__linux__)
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+#endif
+};
+
+static void ClosureQueueEvent_init(struct ClosureQueueEvent *self);
+
+static void ClosureQueueEvent_destroy(struct ClosureQueueEvent *self);
+
+static unsigned ClosureQueueEvent_prepare(struct ClosureQueueEvent *self);
+
+static void ClosureQueueEvent_wait(struct ClosureQueueEvent *self, unsigned word);
+
+static void ClosureQueueEvent_notify(struct ClosureQueueEvent *self);
+
+/*
+ * ClosureQueue
+ */
+struct ClosureQueueCell {
+    size_t sequence;    // equals the position of the cell when empty, the position + 1 when full
+    struct Closure *closure;
+};
+
+struct ClosureQueue {
+    size_t enqueuePosition __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    size_t dequeuePosition __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    struct ClosureQueueEvent notEmpty __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    struct ClosureQueueEvent notFull __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    bool closed __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+    size_t mask;
+    struct ClosureQueueCell *cells;
+    void *allocation;   // the allocation self is aligned within, to be freed
+};
+
+static size_t ClosureQueue_claim(struct ClosureQueue *self, struct Closure **out, size_t n);
+
+/*
+ * IMPLEMENTATION
+ */
+struct ClosureQueue *ClosureQueue_new(const size_t capacity) {
+    assert(capacity > 0);
+    void *allocation;
+    struct ClosureQueue *self = __Closure_allocateAligned(sizeof(*self), &allocation);
+    self->allocation = allocation;
+    size_t cells = 1;
+    while (cells < capacity) {
+        cells <<= 1u;
+    }
+    self->enqueuePosition = 0;
+    self->dequeuePosition = 0;
+    ClosureQueueEvent_init(&self->notEmpty);
+    ClosureQueueEvent_init(&self->notFull);
+    self->closed = false;
+    self->mask = cells - 1;
+    self->cells = Option_unwrap(Alligator_malloc(cells * sizeof(self->cells[0])));
+    for (size_t i = 0; i < cells; i++) {
+        self->cells[i].sequence = i;
+        self->cells[i].closure = NULL;
+    }
+    return self;
+}
+
+size_t ClosureQueue_capacity(const struct ClosureQueue *const self) {
+    assert(self);
+    return self->mask + 1;
+}
+
+size_t ClosureQueue_size(const struct ClosureQueue *const self) {
+    assert(self);
+    const size_t dequeuePosition = __atomic_load_n(&self->dequeuePosition, __ATOMIC_ACQUIRE);
+    const size_t enqueuePosition = __atomic_load_n(&self->enqueuePosition, __ATOMIC_ACQUIRE);
+    const size_t size = enqueuePosition - dequeuePosition;
+    // positions are loaded one after the other, so that the difference may be off while concurrently accessed
+    return (intptr_t) size < 0 ? 0 : (size > self->mask + 1 ? self->mask + 1 : size);
+}
+
+bool ClosureQueue_tryPush(struct ClosureQueue *const self, struct Closure *const closure) {
+    assert(self);
+    assert(closure);
+    assert(!__atomic_load_n(&self->closed, __ATOMIC_RELAXED));
+    size_t position = __atomic_load_n(&self->enqueuePosition, __ATOMIC_RELAXED);
+    while (true) {
+        struct ClosureQueueCell *cell = &self->cells[position & self->mask];
+        const intptr_t difference =
+                (intptr_t) (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - position);
+        if (0 == difference) {
+            if (__atomic_compare_exchange_n(&self->enqueuePosition, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->closure = closure;
+                __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+                ClosureQueueEvent_notify(&self->notEmpty);
+                return true;
+            }
+        } else if (difference < 0) {
+            // the cell still holds the closure pushed a lap before: the queue is full
+            return false;
+        } else {
+            position = __atomic_load_n(&self->enqueuePosition, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void ClosureQueue_push(struct ClosureQueue *const self, struct Closure *const closure) {
+    assert(self);
+    assert(closure);
+    while (true) {
+        for (size_t spin = 0; spin < SPINS_BEFORE_SLEEP; spin++) {
+            if (ClosureQueue_tryPush(self, closure)) {
+                return;
+            }
+        }
+        const unsigned word = ClosureQueueEvent_prepare(&self->notFull);
+        if (ClosureQueue_tryPush(self, closure)) {
+            return;
+        }
+        ClosureQueueEvent_wait(&self->notFull, word);
+    }
+}
+
+Option ClosureQueue_tryPop(struct ClosureQueue *const self) {
+    assert(self);
+    struct Closure *closure = NULL;
+    return 1 == ClosureQueue_claim(self, &closure, 1) ? Option_some(closure) : None;
+}
+
+Option ClosureQueue_pop(struct ClosureQueue *const self) {
+    assert(self);
+    struct Closure *closure = NULL;
+    return 1 == ClosureQueue_popBatch(self, &closure, 1) ? Option_some(closure) : None;
+}
+
+size_t ClosureQueue_popBatch(struct ClosureQueue *const self, struct Closure **const out, const size_t n) {
+    assert(self);
+    assert(out);
+    if (0 == n) {
+        return 0;
+    }
+    while (true) {
+        for (size_t spin = 0; spin < SPINS_BEFORE_SLEEP; spin++) {
+            const size_t claimed = ClosureQueue_claim(self, out, n);
+            if (claimed > 0) {
+                return claimed;
+            }
+        }
+        const unsigned word = ClosureQueueEvent_prepare(&self->notEmpty);
+        const bool closed = __atomic_load_n(&self->closed, __ATOMIC_SEQ_CST);
+        // closures pushed before closing are visible once closed is: nothing more will come if none is left
+        const size_t claimed = ClosureQueue_claim(self, out, n);
+        if (claimed > 0 || closed) {
+            return claimed;
+        }
+        ClosureQueueEvent_wait(&self->notEmpty, word);
+    }
+}
+
+void ClosureQueue_close(struct ClosureQueue *const self) {
+    assert(self);
+    __atomic_store_n(&self->closed, true, __ATOMIC_SEQ_CST);
+    ClosureQueueEvent_notify(&self->notEmpty);
+}
+
+void ClosureQueue_delete(struct ClosureQueue *const self) {
+    if (self) {
+        Option closure;
+        while (Option_isSome(closure = ClosureQueue_tryPop(self))) {
+            Closure_delete(Option_unwrap(closure));
+        }
+        ClosureQueueEvent_destroy(&self->notFull);
+        ClosureQueueEvent_destroy(&self->notEmpty);
+        Alligator_free(self->cells);
+        Alligator_free(self->allocation);
+    }
+}
+
+/*
+ * Claims the longest run, at most n long, of full cells starting at the dequeue position with a single
+ * compare-and-swap, so that a batch costs as much contention as a single closure.
+ */
+size_t ClosureQueue_claim(struct ClosureQueue *const self, struct Closure **const out, const size_t n) {
+    size_t position = __atomic_load_n(&self->dequeuePosition, __ATOMIC_RELAXED);
+    while (true) {
+        const intptr_t difference =
+                (intptr_t) (__atomic_load_n(&self->cells[position & self->mask].sequence, __ATOMIC_ACQUIRE) -
+                            (position + 1));
+        if (0 == difference) {
+            size_t claimed = 1;
+            while (claimed < n && __atomic_load_n(&self->cells[(position + claimed) & self->mask].sequence,
+                                                  __ATOMIC_ACQUIRE) == position + claimed + 1) {
+                claimed++;
+            }
+            if (__atomic_compare_exchange_n(&self->dequeuePosition, &position, position + claimed, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                for (size_t i = 0; i < claimed; i++) {
+                    struct ClosureQueueCell *cell = &self->cells[(position + i) & self->mask];
+                    out[i] = cell->closure;
+                    __atomic_store_n(&cell->sequence, position + i + self->mask + 1, __ATOMIC_RELEASE);
+                }
+                ClosureQueueEvent_notify(&self->notFull);
+                return claimed;
+            }
+        } else if (difference < 0) {
+            // the cell has not been filled yet: the queue is empty
+            return 0;
+        } else {
+            position = __atomic_load_n(&self->dequeuePosition, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * ClosureQueueEvent
+ */
+void ClosureQueueEvent_init(struct ClosureQueueEvent *const self) {
+    assert(self);
+    self->word = 0;
+#if !defined(__linux__)
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->condition, NULL);
+#endif
+}
+
+void ClosureQueueEvent_destroy(struct ClosureQueueEvent *const self) {
+    assert(self);
+#if !defined(__linux__)
+    pthread_cond_destroy(&self->condition);
+    pthread_mutex_destroy(&self->mutex);
+#else
+    (void) self;
+#endif
+}
+
+unsigned ClosureQueueEvent_prepare(struct ClosureQueueEvent *const self) {
+    assert(self);
+    return __atomic_or_fetch(&self->word, 1u, __ATOMIC_SEQ_CST);
+}
+
+void ClosureQueueEvent_wait(struct ClosureQueueEvent *const self, const unsigned word) {
+    assert(self);
+#if defined(__linux__)
+    // returns at once if the word already changed, spurious wake-ups are handled by the callers looping
+    syscall(SYS_futex, &self->word, FUTEX_WAIT_PRIVATE, word, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&self->mutex);
+    while (word == __atomic_load_n(&self->word, __ATOMIC_SEQ_CST)) {
+        pthread_cond_wait(&self->condition, &self->mutex);
+    }
+    pthread_mutex_unlock(&self->mutex);
+#endif
+}
+
+void ClosureQueueEvent_notify(struct ClosureQueueEvent *const self) {
+    assert(self);
+    // orders the update of the queue before reading the word, pairing with setting the bit in prepare
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    unsigned word = __atomic_load_n(&self->word, __ATOMIC_RELAXED);
+    if (word & 1u) {
+#if !defined(__linux__)
+        pthread_mutex_lock(&self->mutex);
+#endif
+        bool woken = false;
+        while ((word & 1u) && !(woken = __atomic_compare_exchange_n(&self->word, &word, (word + 2u) & ~1u, false,
+                                                                  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))) {
+        }
+#if defined(__linux__)
+        if (woken) {
+            syscall(SYS_futex, &self->word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+        }
+#else
+        if (woken) {
+            pthread_cond_broadcast(&self->condition);
+        }
+        pthread_mutex_unlock(&self->mutex);
+#endif
+    }
+}
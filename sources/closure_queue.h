@@ -0,0 +1,124 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <option/option.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A bounded lock-free multi-producer multi-consumer queue of closures, meant to post work from any thread to one or
+ * more event-loop threads.
+ *
+ * Closures are stored in an array of sequenced cells, see "Bounded MPMC queue" by Dmitry Vyukov: producers and
+ * consumers claim cells with a compare-and-swap on their own index and never block each other, while idle consumers,
+ * and producers finding the queue full, sleep on a futex on Linux, on a condition elsewhere.
+ */
+struct ClosureQueue;
+
+/**
+ * Creates an empty queue holding at most capacity closures, rounded up to a power of 2.
+ */
+extern struct ClosureQueue *ClosureQueue_new(size_t capacity)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Returns the number of closures this queue can hold.
+ */
+extern size_t ClosureQueue_capacity(const struct ClosureQueue *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns the number of closures in this queue, which may be already outdated when concurrently accessed.
+ */
+extern size_t ClosureQueue_size(const struct ClosureQueue *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Appends closure to this queue taking ownership of the given reference, returns `false` leaving the reference to
+ * the caller if the queue is full.
+ *
+ * @attention closures must not be pushed to a closed queue.
+ */
+extern bool ClosureQueue_tryPush(struct ClosureQueue *self, struct Closure *closure)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Appends closure to this queue taking ownership of the given reference, waiting for room if the queue is full.
+ *
+ * @attention closures must not be pushed to a closed queue.
+ */
+extern void ClosureQueue_push(struct ClosureQueue *self, struct Closure *closure)
+__attribute__((__nonnull__));
+
+/**
+ * Removes the first closure of this queue and returns the reference to it, or returns `None` if the queue is empty.
+ */
+extern Option ClosureQueue_tryPop(struct ClosureQueue *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Removes the first closure of this queue and returns the reference to it, waiting for one if the queue is empty.
+ * Returns `None` once the queue has been closed and every closure pushed has been popped.
+ */
+extern Option ClosureQueue_pop(struct ClosureQueue *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Removes at most n closures from this queue, claiming them at once, stores the references to them in out and returns
+ * the number of closures stored, waiting for at least one if the queue is empty.
+ * Returns 0 once the queue has been closed and every closure pushed has been popped.
+ */
+extern size_t ClosureQueue_popBatch(struct ClosureQueue *self, struct Closure **out, size_t n)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Signals that no more closures will be pushed, waking up the consumers waiting on this queue.
+ */
+extern void ClosureQueue_close(struct ClosureQueue *self)
+__attribute__((__nonnull__));
+
+/**
+ * Releases the closures left in this queue and deletes it.
+ *
+ * @attention the queue must not be accessed concurrently while being deleted.
+ */
+extern void ClosureQueue_delete(struct ClosureQueue *self);
+
+#ifdef __cplusplus
+}
+#endif
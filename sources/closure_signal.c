@@ -0,0 +1,268 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <alligator/alligator.h>
+#include "closure_aligned.h"
+#include "closure_signal.h"
+
+#define STRIPES                 16
+#define SPINS_BEFORE_YIELD      64
+
+/*
+ * An immutable array of slots, replaced as a whole on every change.
+ */
+struct ClosureSignalSnapshot {
+    size_t length;
+    struct Closure *slots[];
+};
+
+/*
+ * Snapshots and slots waiting for a grace period to be reclaimed.
+ */
+struct ClosureSignalRetired {
+    struct ClosureSignalRetired *next;
+    struct ClosureSignalSnapshot *snapshot;
+    struct Closure *closure;
+};
+
+struct ClosureSignalCounter {
+    unsigned long value;
+} __attribute__((__aligned__(CLOSURE_CACHE_LINE_SIZE)));
+
+/*
+ * Emitters announce themselves on one of two sets of counters, picked by the parity of epoch, each set striped among
+ * threads so that concurrent emitters do not contend on the same cache line.
+ */
+struct ClosureSignal {
+    void *allocation;               // the allocation self is aligned within, to be freed
+    struct ClosureSignalSnapshot *snapshot;
+    unsigned long epoch;
+    struct ClosureSignalCounter readers[2][STRIPES];
+    struct ClosureSignalRetired *retired;
+    pthread_mutex_t mutex;          // serializes writers
+    pthread_mutex_t gracePeriod;    // serializes epoch flips
+};
+
+static size_t nextStripe = 0;
+
+static __thread size_t stripe = SIZE_MAX;
+
+static __thread size_t emitting = 0;
+
+static size_t ClosureSignal_stripe(void);
+
+static void ClosureSignal_publish(struct ClosureSignal *self, struct ClosureSignalSnapshot *snapshot,
+                                  struct Closure *closure);
+
+static void ClosureSignal_synchronize(struct ClosureSignal *self);
+
+static void ClosureSignal_reclaim(struct ClosureSignalRetired *retired);
+
+/*
+ * IMPLEMENTATION
+ */
+struct ClosureSignal *ClosureSignal_new(void) {
+    void *allocation;
+    struct ClosureSignal *self = __Closure_allocateAligned(sizeof(*self), &allocation);
+    memset(self, 0, sizeof(*self));
+    self->allocation = allocation;
+    self->snapshot = NULL;
+    self->epoch = 0;
+    self->retired = NULL;
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_mutex_init(&self->gracePeriod, NULL);
+    return self;
+}
+
+size_t ClosureSignal_size(struct ClosureSignal *const self) {
+    assert(self);
+    pthread_mutex_lock(&self->mutex);
+    const size_t size = self->snapshot ? self->snapshot->length : 0;
+    pthread_mutex_unlock(&self->mutex);
+    return size;
+}
+
+void ClosureSignal_connect(struct ClosureSignal *const self, struct Closure *const closure) {
+    assert(self);
+    assert(closure);
+    pthread_mutex_lock(&self->mutex);
+    const struct ClosureSignalSnapshot *current = self->snapshot;
+    const size_t length = current ? current->length : 0;
+    struct ClosureSignalSnapshot *snapshot = Option_unwrap(
+            Alligator_malloc(sizeof(*snapshot) + (length + 1) * sizeof(snapshot->slots[0]))
+    );
+    for (size_t i = 0; i < length; i++) {
+        snapshot->slots[i] = current->slots[i];
+    }
+    snapshot->slots[length] = closure;
+    snapshot->length = length + 1;
+    ClosureSignal_publish(self, snapshot, NULL);
+}
+
+bool ClosureSignal_disconnect(struct ClosureSignal *const self, struct Closure *const closure) {
+    assert(self);
+    assert(closure);
+    pthread_mutex_lock(&self->mutex);
+    const struct ClosureSignalSnapshot *current = self->snapshot;
+    const size_t length = current ? current->length : 0;
+    size_t found = length;
+    for (size_t i = 0; i < length; i++) {
+        if (closure == current->slots[i]) {
+            found = i;
+            break;
+        }
+    }
+    if (found == length) {
+        pthread_mutex_unlock(&self->mutex);
+        return false;
+    }
+    struct ClosureSignalSnapshot *snapshot = NULL;
+    if (length > 1) {
+        snapshot = Option_unwrap(Alligator_malloc(sizeof(*snapshot) + (length - 1) * sizeof(snapshot->slots[0])));
+        for (size_t i = 0, j = 0; i < length; i++) {
+            if (i != found) {
+                snapshot->slots[j++] = current->slots[i];
+            }
+        }
+        snapshot->length = length - 1;
+    }
+    ClosureSignal_publish(self, snapshot, closure);
+    return true;
+}
+
+size_t ClosureSignal_emit(struct ClosureSignal *const self, const Option arguments) {
+    assert(self);
+    struct ClosureSignalCounter *counter =
+            &self->readers[__atomic_load_n(&self->epoch, __ATOMIC_RELAXED) & 1u][ClosureSignal_stripe()];
+    // announce before loading the snapshot: a writer either sees the announcement or has already published
+    __atomic_fetch_add(&counter->value, 1, __ATOMIC_SEQ_CST);
+    const struct ClosureSignalSnapshot *snapshot = __atomic_load_n(&self->snapshot, __ATOMIC_SEQ_CST);
+    size_t called = 0;
+    if (snapshot) {
+        emitting++;
+        for (called = 0; called < snapshot->length; called++) {
+            Closure_callWith(snapshot->slots[called], arguments);
+        }
+        emitting--;
+    }
+    __atomic_fetch_sub(&counter->value, 1, __ATOMIC_RELEASE);
+    return called;
+}
+
+void ClosureSignal_collect(struct ClosureSignal *const self) {
+    assert(self);
+    assert(0 == emitting);
+    pthread_mutex_lock(&self->mutex);
+    struct ClosureSignalRetired *retired = self->retired;
+    self->retired = NULL;
+    pthread_mutex_unlock(&self->mutex);
+    ClosureSignal_synchronize(self);
+    ClosureSignal_reclaim(retired);
+}
+
+void ClosureSignal_delete(struct ClosureSignal *const self) {
+    if (self) {
+        ClosureSignal_reclaim(self->retired);
+        if (self->snapshot) {
+            for (size_t i = 0; i < self->snapshot->length; i++) {
+                Closure_delete(self->snapshot->slots[i]);
+            }
+            Alligator_free(self->snapshot);
+        }
+        pthread_mutex_destroy(&self->gracePeriod);
+        pthread_mutex_destroy(&self->mutex);
+        Alligator_free(self->allocation);
+    }
+}
+
+size_t ClosureSignal_stripe(void) {
+    if (__builtin_expect(SIZE_MAX == stripe, 0)) {
+        stripe = __atomic_fetch_add(&nextStripe, 1, __ATOMIC_RELAXED) % STRIPES;
+    }
+    return stripe;
+}
+
+/*
+ * Publishes snapshot replacing the current one, that is retired along with closure, if any, and unlocks the mutex.
+ * The grace period is waited outside of the mutex, so that slots may connect and disconnect meanwhile; writers
+ * running inside an emission can't wait for it, so they leave the retired items to the next writer.
+ */
+void ClosureSignal_publish(struct ClosureSignal *const self, struct ClosureSignalSnapshot *const snapshot,
+                           struct Closure *const closure) {
+    assert(self);
+    struct ClosureSignalRetired *retired = Option_unwrap(Alligator_malloc(sizeof(*retired)));
+    retired->snapshot = self->snapshot;
+    retired->closure = closure;
+    retired->next = self->retired;
+    __atomic_store_n(&self->snapshot, snapshot, __ATOMIC_SEQ_CST);
+    if (emitting > 0) {
+        self->retired = retired;
+        pthread_mutex_unlock(&self->mutex);
+        return;
+    }
+    self->retired = NULL;
+    pthread_mutex_unlock(&self->mutex);
+    ClosureSignal_synchronize(self);
+    ClosureSignal_reclaim(retired);
+}
+
+/*
+ * Waits for the emitters that might have loaded a retired snapshot.
+ * Emitters that loaded the epoch before it has been flipped may still announce themselves on the old parity, but they
+ * are bound to load the new snapshot; flipping twice waits for the ones announced on both parities.
+ */
+void ClosureSignal_synchronize(struct ClosureSignal *const self) {
+    assert(self);
+    pthread_mutex_lock(&self->gracePeriod);
+    for (size_t flip = 0; flip < 2; flip++) {
+        const unsigned long epoch = __atomic_fetch_add(&self->epoch, 1, __ATOMIC_SEQ_CST);
+        struct ClosureSignalCounter *readers = self->readers[epoch & 1u];
+        for (size_t i = 0; i < STRIPES; i++) {
+            for (size_t spin = 0; 0 != __atomic_load_n(&readers[i].value, __ATOMIC_SEQ_CST); spin++) {
+                if (spin >= SPINS_BEFORE_YIELD) {
+                    sched_yield();
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&self->gracePeriod);
+}
+
+void ClosureSignal_reclaim(struct ClosureSignalRetired *retired) {
+    while (retired) {
+        struct ClosureSignalRetired *next = retired->next;
+        Alligator_free(retired->snapshot);
+        Closure_delete(retired->closure);
+        Alligator_free(retired);
+        retired = next;
+    }
+}
@@ -0,0 +1,101 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <option/option.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A multicast list of closures, the slots, called all at once by `ClosureSignal_emit`.
+ * Emission is wait-free and can happen from any number of threads at the same time: emitters call the slots of an
+ * immutable snapshot without taking any lock, while connecting and disconnecting slots publishes a new snapshot.
+ * Snapshots and disconnected slots are reclaimed only once every emission that might still be using them is over.
+ * Slots may be called concurrently, therefore they must be thread-safe if the signal is emitted by several threads.
+ */
+struct ClosureSignal;
+
+extern struct ClosureSignal *ClosureSignal_new(void)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Returns the number of slots currently connected.
+ */
+extern size_t ClosureSignal_size(struct ClosureSignal *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Connects closure to this signal taking ownership of the given reference.
+ * May be called from a slot, in which case the slot will be called by the next emissions.
+ */
+extern void ClosureSignal_connect(struct ClosureSignal *self, struct Closure *closure)
+__attribute__((__nonnull__));
+
+/**
+ * Disconnects closure from this signal, returns `false` if closure was not connected.
+ * The reference owned by the signal is dropped once the emissions in progress are over; if called from a slot, that
+ * is deferred to the next call to `ClosureSignal_connect`, `ClosureSignal_disconnect` or `ClosureSignal_collect`
+ * made outside of any emission, or to `ClosureSignal_delete`.
+ */
+extern bool ClosureSignal_disconnect(struct ClosureSignal *self, struct Closure *closure)
+__attribute__((__nonnull__));
+
+/**
+ * Calls every slot connected with the given arguments and returns the number of slots called.
+ * Results are discarded, therefore slots should not return anything that needs to be released.
+ */
+extern size_t ClosureSignal_emit(struct ClosureSignal *self, Option arguments)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Waits for the emissions in progress to be over and reclaims the slots whose release has been deferred.
+ *
+ * @attention must not be called from a slot.
+ */
+extern void ClosureSignal_collect(struct ClosureSignal *self)
+__attribute__((__nonnull__));
+
+/**
+ * Deletes this signal releasing every slot.
+ *
+ * @attention there must be no emission in progress.
+ */
+extern void ClosureSignal_delete(struct ClosureSignal *self);
+
+#ifdef __cplusplus
+}
+#endif
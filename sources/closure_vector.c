@@ -0,0 +1,252 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <alligator/alligator.h>
+#include "closure_vector.h"
+#include "closure_instrumentation.h"
+
+#define NIL     SIZE_MAX
+
+/*
+ * Entries of the same class, laid out as parallel arrays indexed by slot.
+ */
+struct ClosureVectorGroup {
+    const struct ClosureClass *class;
+    /* The size of each environment stored in the group, 0 if environments are referenced. */
+    size_t stride;
+    size_t length;
+    size_t capacity;
+    unsigned char *environments;
+    Option *references;
+    /* The closures pushed, kept alive until the vector is deleted, NULL for emplaced entries. */
+    struct Closure **closures;
+    /* The index of each entry in the vector, to store results in insertion order. */
+    size_t *positions;
+};
+
+struct ClosureVectorEntry {
+    size_t group;
+    size_t slot;
+};
+
+struct ClosureVector {
+    struct ClosureVectorGroup *groups;
+    size_t groupsLength;
+    size_t groupsCapacity;
+    struct ClosureVectorEntry *entries;
+    size_t length;
+    size_t capacity;
+    size_t lastGroup;
+};
+
+static size_t ClosureVector_findGroup(struct ClosureVector *self, const struct ClosureClass *class, size_t stride);
+
+static size_t ClosureVector_append(struct ClosureVector *self, size_t group, struct Closure *closure);
+
+/*
+ * IMPLEMENTATION
+ */
+struct ClosureVector *ClosureVector_new(void) {
+    struct ClosureVector *self = Option_unwrap(Alligator_malloc(sizeof(*self)));
+    self->groups = NULL;
+    self->groupsLength = 0;
+    self->groupsCapacity = 0;
+    self->entries = NULL;
+    self->length = 0;
+    self->capacity = 0;
+    self->lastGroup = NIL;
+    return self;
+}
+
+size_t ClosureVector_size(const struct ClosureVector *const self) {
+    assert(self);
+    return self->length;
+}
+
+size_t ClosureVector_emplace(struct ClosureVector *const self, const struct ClosureClass *const class,
+                             const Option environment) {
+    assert(self);
+    assert(class);
+    assert(class->call);
+    const size_t group = ClosureVector_findGroup(self, class, class->environmentSize);
+    const size_t index = ClosureVector_append(self, group, NULL);
+    const struct ClosureVectorEntry entry = self->entries[index];
+    struct ClosureVectorGroup *g = &self->groups[group];
+    if (g->stride > 0) {
+        if (Option_isSome(environment)) {
+            memcpy(g->environments + entry.slot * g->stride, Option_unwrap(environment), g->stride);
+        }
+    } else {
+        g->references[entry.slot] = environment;
+    }
+    return index;
+}
+
+size_t ClosureVector_push(struct ClosureVector *const self, struct Closure *const closure) {
+    assert(self);
+    assert(closure);
+    const size_t group = ClosureVector_findGroup(self, Closure_getClass(closure), 0);
+    const size_t index = ClosureVector_append(self, group, closure);
+    self->groups[group].references[self->entries[index].slot] = Closure_getEnvironment(closure);
+    return index;
+}
+
+Option ClosureVector_getEnvironment(struct ClosureVector *const self, const size_t index) {
+    assert(self);
+    assert(index < self->length);
+    const struct ClosureVectorEntry entry = self->entries[index];
+    const struct ClosureVectorGroup *g = &self->groups[entry.group];
+    return g->stride > 0 ? Option_some(g->environments + entry.slot * g->stride) : g->references[entry.slot];
+}
+
+void ClosureVector_callAll(struct ClosureVector *const self, const Option arguments, Result *const out) {
+    assert(self);
+    for (size_t group = 0; group < self->groupsLength; group++) {
+        const struct ClosureVectorGroup *g = &self->groups[group];
+        const Closure_CallFn callFn = g->class->call;
+        const size_t *const positions = g->positions;
+        const size_t length = g->length;
+        uint64_t errors = 0;
+#if defined(CLOSURE_INSTRUMENTATION)
+        const bool instrumented = length > 0 && __ClosureInstrumentation_isEnabled();
+        const uint64_t start = instrumented ? __ClosureInstrumentation_now() : 0;
+#endif
+        if (g->stride > 0) {
+            const size_t stride = g->stride;
+            unsigned char *environment = g->environments;
+            for (size_t slot = 0; slot < length; slot++, environment += stride) {
+                const Result result = callFn(Option_some(environment), arguments);
+                errors += Result_isError(result);
+                if (out) {
+                    out[positions[slot]] = result;
+                }
+            }
+        } else {
+            const Option *const references = g->references;
+            for (size_t slot = 0; slot < length; slot++) {
+                const Result result = callFn(references[slot], arguments);
+                errors += Result_isError(result);
+                if (out) {
+                    out[positions[slot]] = result;
+                }
+            }
+        }
+#if defined(CLOSURE_INSTRUMENTATION)
+        if (instrumented) {
+            __ClosureInstrumentation_record(g->class, length, errors, __ClosureInstrumentation_now() - start);
+        }
+#else
+        (void) errors;
+#endif
+    }
+}
+
+void ClosureVector_delete(struct ClosureVector *const self) {
+    if (self) {
+        for (size_t group = 0; group < self->groupsLength; group++) {
+            struct ClosureVectorGroup *g = &self->groups[group];
+            for (size_t slot = 0; slot < g->length; slot++) {
+                if (g->closures[slot]) {
+                    Closure_release(g->closures[slot]);
+                } else if (g->class->delete) {
+                    g->class->delete(g->stride > 0 ? Option_some(g->environments + slot * g->stride)
+                                                   : g->references[slot]);
+                }
+            }
+            Alligator_free(g->environments);
+            Alligator_free(g->references);
+            Alligator_free(g->closures);
+            Alligator_free(g->positions);
+        }
+        Alligator_free(self->groups);
+        Alligator_free(self->entries);
+        Alligator_free(self);
+    }
+}
+
+/*
+ * Groups are few, usually a handful of event handler types, so they are looked up linearly starting from the last
+ * one used, that is the right one when entries of the same class are added in a row.
+ */
+size_t ClosureVector_findGroup(struct ClosureVector *const self, const struct ClosureClass *const class,
+                               const size_t stride) {
+    assert(self);
+    assert(class);
+    if (NIL != self->lastGroup) {
+        const struct ClosureVectorGroup *g = &self->groups[self->lastGroup];
+        if (class == g->class && stride == g->stride) {
+            return self->lastGroup;
+        }
+    }
+    for (size_t group = 0; group < self->groupsLength; group++) {
+        const struct ClosureVectorGroup *g = &self->groups[group];
+        if (class == g->class && stride == g->stride) {
+            return self->lastGroup = group;
+        }
+    }
+    if (self->groupsLength == self->groupsCapacity) {
+        self->groupsCapacity = self->groupsCapacity > 0 ? self->groupsCapacity * 2 : 4;
+        self->groups = Option_unwrap(
+                Alligator_realloc(self->groups, self->groupsCapacity * sizeof(self->groups[0]))
+        );
+    }
+    self->groups[self->groupsLength] = (struct ClosureVectorGroup) {.class=class, .stride=stride};
+    return self->lastGroup = self->groupsLength++;
+}
+
+/*
+ * Environments of the same size are packed without padding: the alignment of a type always divides its size, so each
+ * one is suitably aligned as long as the array itself is.
+ */
+size_t ClosureVector_append(struct ClosureVector *const self, const size_t group, struct Closure *const closure) {
+    assert(self);
+    assert(group < self->groupsLength);
+    struct ClosureVectorGroup *g = &self->groups[group];
+    if (g->length == g->capacity) {
+        g->capacity = g->capacity > 0 ? g->capacity * 2 : 8;
+        if (g->stride > 0) {
+            g->environments = Option_unwrap(Alligator_realloc(g->environments, g->capacity * g->stride));
+        } else {
+            g->references = Option_unwrap(Alligator_realloc(g->references, g->capacity * sizeof(g->references[0])));
+        }
+        g->closures = Option_unwrap(Alligator_realloc(g->closures, g->capacity * sizeof(g->closures[0])));
+        g->positions = Option_unwrap(Alligator_realloc(g->positions, g->capacity * sizeof(g->positions[0])));
+    }
+    if (self->length == self->capacity) {
+        self->capacity = self->capacity > 0 ? self->capacity * 2 : 8;
+        self->entries = Option_unwrap(Alligator_realloc(self->entries, self->capacity * sizeof(self->entries[0])));
+    }
+    const size_t slot = g->length++;
+    const size_t index = self->length++;
+    g->closures[slot] = closure;
+    g->positions[slot] = index;
+    self->entries[index] = (struct ClosureVectorEntry) {.group=group, .slot=slot};
+    return index;
+}
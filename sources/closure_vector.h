@@ -0,0 +1,99 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <option/option.h>
+#include <result/result.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A collection of heterogeneous closures meant to be called all at once, e.g. the handlers of an event.
+ * Entries are grouped by class and the environments of each group are stored contiguously, so that
+ * `ClosureVector_callAll` runs one tight loop per class, calling always the same function over adjacent memory,
+ * rather than an unpredictable indirect call per entry.
+ */
+struct ClosureVector;
+
+extern struct ClosureVector *ClosureVector_new(void)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Returns the number of entries of this vector.
+ */
+extern size_t ClosureVector_size(const struct ClosureVector *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Adds an entry of the given class, without creating a closure, and returns its index.
+ * If class has an environmentSize, the environment is stored in the vector, next to the ones of the same class, and
+ * initialized copying environmentSize bytes from the value of environment, or left uninitialized if environment is
+ * `None`; otherwise environment is referenced as is.
+ * Either way the environment is released by the delete hook of class, if any, along with the vector.
+ */
+extern size_t ClosureVector_emplace(struct ClosureVector *self, const struct ClosureClass *class, Option environment)
+__attribute__((__nonnull__(1, 2)));
+
+/**
+ * Adds closure to the vector, taking ownership of the given reference, and returns its index.
+ * The environment of closure is referenced rather than copied, so that closure can still be called on its own;
+ * the reference is dropped along with the vector.
+ */
+extern size_t ClosureVector_push(struct ClosureVector *self, struct Closure *closure)
+__attribute__((__nonnull__));
+
+/**
+ * Returns the environment of the entry at index.
+ * Environments stored in the vector may be moved by subsequent insertions.
+ */
+extern Option ClosureVector_getEnvironment(struct ClosureVector *self, size_t index)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Calls every entry with the same arguments, storing the result of the i-th entry in out[i].
+ * out must have room for `ClosureVector_size` results, or be `NULL` if the results are not needed.
+ */
+extern void ClosureVector_callAll(struct ClosureVector *self, Option arguments, Result *out)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Deletes this vector releasing every environment and closure it owns.
+ */
+extern void ClosureVector_delete(struct ClosureVector *self);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,448 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <alligator/alligator.h>
+#include "closure_wheel.h"
+
+#define LEVELS          4
+#define SLOT_BITS       8
+#define SLOTS           (1u << SLOT_BITS)
+#define SLOT_MASK       ((uint64_t) SLOTS - 1)
+#define HORIZON         ((uint64_t) 1 << (LEVELS * SLOT_BITS))
+#define CHUNK_NODES     256
+
+enum ClosureWheelNodeState {
+    ClosureWheelNodeState_Free, ClosureWheelNodeState_Pending, ClosureWheelNodeState_Running
+};
+
+/*
+ * Timers are linked in the slots through next and pprev, that points to the pointer pointing to the node, so that they
+ * can be unlinked in constant time; nodes are recycled but never freed before the wheel, so that stale handles can
+ * always be told apart by their generation.
+ */
+struct ClosureWheelNode {
+    struct ClosureWheelNode *next;
+    struct ClosureWheelNode **pprev;
+    struct Closure *closure;
+    uint64_t expires;
+    uint64_t period;
+    unsigned long generation;
+    size_t level;
+    enum ClosureWheelNodeState state;
+    bool cancelled;
+};
+
+struct ClosureWheelChunk {
+    struct ClosureWheelChunk *next;
+    struct ClosureWheelNode nodes[CHUNK_NODES];
+};
+
+/*
+ * Level l has SLOTS slots each one spanning SLOTS^l ticks; timers are moved down one or more levels, cascading, when
+ * the slot of the upper level they belong to is reached.
+ */
+struct ClosureWheel {
+    struct ClosureWheelNode *slots[LEVELS][SLOTS];
+    size_t counts[LEVELS];      // timers per level, to skip the ticks where nothing can happen
+    uint64_t now;
+    size_t size;
+    struct ClosureWheelNode *free;
+    struct ClosureWheelChunk *chunks;
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;   // wakes up the driver thread when stopping
+    pthread_t thread;
+    uint64_t tickNanoseconds;
+    bool running;
+    bool stopping;
+};
+
+static struct ClosureWheelNode *ClosureWheel_allocateNode(struct ClosureWheel *self);
+
+static void ClosureWheel_freeNode(struct ClosureWheel *self, struct ClosureWheelNode *node);
+
+static void ClosureWheel_insert(struct ClosureWheel *self, struct ClosureWheelNode *node);
+
+static void ClosureWheel_unlink(struct ClosureWheel *self, struct ClosureWheelNode *node);
+
+static uint64_t ClosureWheel_idle(const struct ClosureWheel *self);
+
+static struct ClosureWheelNode *ClosureWheel_step(struct ClosureWheel *self);
+
+static void ClosureWheel_addNanoseconds(struct timespec *time, uint64_t nanoseconds);
+
+static void *ClosureWheel_run(void *argument);
+
+/*
+ * IMPLEMENTATION
+ */
+struct ClosureWheel *ClosureWheel_new(void) {
+    struct ClosureWheel *self = Option_unwrap(Alligator_calloc(1, sizeof(*self)));
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&self->condition, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_mutex_init(&self->mutex, NULL);
+    return self;
+}
+
+uint64_t ClosureWheel_now(struct ClosureWheel *const self) {
+    assert(self);
+    pthread_mutex_lock(&self->mutex);
+    const uint64_t now = self->now;
+    pthread_mutex_unlock(&self->mutex);
+    return now;
+}
+
+size_t ClosureWheel_size(struct ClosureWheel *const self) {
+    assert(self);
+    pthread_mutex_lock(&self->mutex);
+    const size_t size = self->size;
+    pthread_mutex_unlock(&self->mutex);
+    return size;
+}
+
+struct ClosureTimer ClosureWheel_schedule(struct ClosureWheel *const self, struct Closure *const closure,
+                                          const uint64_t delay, const uint64_t period) {
+    assert(self);
+    assert(closure);
+    pthread_mutex_lock(&self->mutex);
+    struct ClosureWheelNode *node = ClosureWheel_allocateNode(self);
+    node->closure = closure;
+    node->expires = self->now + (delay > 0 ? delay : 1);
+    node->period = period;
+    node->cancelled = false;
+    node->state = ClosureWheelNodeState_Pending;
+    ClosureWheel_insert(self, node);
+    self->size++;
+    const struct ClosureTimer timer = {.__node=node, .__generation=node->generation};
+    pthread_mutex_unlock(&self->mutex);
+    return timer;
+}
+
+bool ClosureWheel_cancel(struct ClosureWheel *const self, const struct ClosureTimer timer) {
+    assert(self);
+    struct ClosureWheelNode *node = timer.__node;
+    if (NULL == node) {
+        return false;
+    }
+    pthread_mutex_lock(&self->mutex);
+    if (timer.__generation != node->generation) {
+        pthread_mutex_unlock(&self->mutex);
+        return false;
+    }
+    if (ClosureWheelNodeState_Running == node->state) {
+        // the closure is being called: only periodic timers are still to be stopped
+        const bool cancelled = node->period > 0 && !node->cancelled;
+        node->cancelled = true;
+        pthread_mutex_unlock(&self->mutex);
+        return cancelled;
+    }
+    assert(ClosureWheelNodeState_Pending == node->state);
+    struct Closure *closure = node->closure;
+    ClosureWheel_unlink(self, node);
+    ClosureWheel_freeNode(self, node);
+    self->size--;
+    pthread_mutex_unlock(&self->mutex);
+    Closure_delete(closure);
+    return true;
+}
+
+/*
+ * Closures are called, and released, outside of the lock so that they can use the wheel themselves.
+ */
+size_t ClosureWheel_advance(struct ClosureWheel *const self, const uint64_t ticks) {
+    assert(self);
+    size_t called = 0;
+    pthread_mutex_lock(&self->mutex);
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        if (0 == self->size) {
+            self->now += ticks - tick;
+            break;
+        }
+        const uint64_t idle = ClosureWheel_idle(self);
+        if (idle > 0) {
+            const uint64_t skip = idle < ticks - tick ? idle : ticks - tick;
+            self->now += skip;
+            tick += skip - 1;
+            continue;
+        }
+        struct ClosureWheelNode *expired = ClosureWheel_step(self);
+        if (NULL == expired) {
+            continue;
+        }
+        pthread_mutex_unlock(&self->mutex);
+        for (struct ClosureWheelNode *node = expired; node; node = node->next) {
+            Closure_call(node->closure);
+            called++;
+        }
+        pthread_mutex_lock(&self->mutex);
+        struct ClosureWheelNode *dead = NULL;
+        while (expired) {
+            struct ClosureWheelNode *node = expired;
+            expired = node->next;
+            if (node->period > 0 && !node->cancelled) {
+                // the wheel may have been advanced meanwhile by another thread
+                node->expires = node->expires + node->period > self->now ? node->expires + node->period : self->now + 1;
+                node->state = ClosureWheelNodeState_Pending;
+                ClosureWheel_insert(self, node);
+                self->size++;
+            } else {
+                node->next = dead;
+                dead = node;
+            }
+        }
+        if (dead) {
+            pthread_mutex_unlock(&self->mutex);
+            for (struct ClosureWheelNode *node = dead; node; node = node->next) {
+                Closure_delete(node->closure);
+            }
+            pthread_mutex_lock(&self->mutex);
+            while (dead) {
+                struct ClosureWheelNode *node = dead;
+                dead = node->next;
+                ClosureWheel_freeNode(self, node);
+            }
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return called;
+}
+
+bool ClosureWheel_start(struct ClosureWheel *const self, const uint64_t tickNanoseconds) {
+    assert(self);
+    assert(tickNanoseconds > 0);
+    pthread_mutex_lock(&self->mutex);
+    if (self->running) {
+        pthread_mutex_unlock(&self->mutex);
+        return false;
+    }
+    self->running = true;
+    self->stopping = false;
+    self->tickNanoseconds = tickNanoseconds;
+    if (0 != pthread_create(&self->thread, NULL, ClosureWheel_run, self)) {
+        self->running = false;
+        pthread_mutex_unlock(&self->mutex);
+        return false;
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return true;
+}
+
+void ClosureWheel_stop(struct ClosureWheel *const self) {
+    assert(self);
+    pthread_mutex_lock(&self->mutex);
+    if (!self->running) {
+        pthread_mutex_unlock(&self->mutex);
+        return;
+    }
+    self->stopping = true;
+    pthread_cond_signal(&self->condition);
+    pthread_mutex_unlock(&self->mutex);
+    pthread_join(self->thread, NULL);
+    pthread_mutex_lock(&self->mutex);
+    self->running = false;
+    self->stopping = false;
+    pthread_mutex_unlock(&self->mutex);
+}
+
+void ClosureWheel_delete(struct ClosureWheel *const self) {
+    if (self) {
+        ClosureWheel_stop(self);
+        for (size_t level = 0; level < LEVELS; level++) {
+            for (size_t slot = 0; slot < SLOTS; slot++) {
+                for (struct ClosureWheelNode *node = self->slots[level][slot]; node; node = node->next) {
+                    Closure_delete(node->closure);
+                }
+            }
+        }
+        while (self->chunks) {
+            struct ClosureWheelChunk *chunk = self->chunks;
+            self->chunks = chunk->next;
+            Alligator_free(chunk);
+        }
+        pthread_cond_destroy(&self->condition);
+        pthread_mutex_destroy(&self->mutex);
+        Alligator_free(self);
+    }
+}
+
+struct ClosureWheelNode *ClosureWheel_allocateNode(struct ClosureWheel *const self) {
+    assert(self);
+    if (NULL == self->free) {
+        struct ClosureWheelChunk *chunk = Option_unwrap(Alligator_calloc(1, sizeof(*chunk)));
+        chunk->next = self->chunks;
+        self->chunks = chunk;
+        for (size_t i = 0; i < CHUNK_NODES; i++) {
+            chunk->nodes[i].next = self->free;
+            self->free = &chunk->nodes[i];
+        }
+    }
+    struct ClosureWheelNode *node = self->free;
+    self->free = node->next;
+    return node;
+}
+
+void ClosureWheel_freeNode(struct ClosureWheel *const self, struct ClosureWheelNode *const node) {
+    assert(self);
+    assert(node);
+    node->generation++;
+    node->state = ClosureWheelNodeState_Free;
+    node->closure = NULL;
+    node->pprev = NULL;
+    node->next = self->free;
+    self->free = node;
+}
+
+/*
+ * Timers due within SLOTS^(l+1) ticks go to level l, in the slot spanning their expiry; timers beyond the horizon
+ * are parked in the farthest slot of the last level and cascaded again from there.
+ */
+void ClosureWheel_insert(struct ClosureWheel *const self, struct ClosureWheelNode *const node) {
+    assert(self);
+    assert(node);
+    assert(node->expires >= self->now);
+    const uint64_t delta = node->expires - self->now;
+    const uint64_t expires = delta < HORIZON ? node->expires : self->now + HORIZON - 1;
+    size_t level = 0;
+    while (level + 1 < LEVELS && (expires - self->now) >= ((uint64_t) 1 << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+    struct ClosureWheelNode **head = &self->slots[level][(expires >> (level * SLOT_BITS)) & SLOT_MASK];
+    node->level = level;
+    self->counts[level]++;
+    node->next = *head;
+    node->pprev = head;
+    if (*head) {
+        (*head)->pprev = &node->next;
+    }
+    *head = node;
+}
+
+void ClosureWheel_unlink(struct ClosureWheel *const self, struct ClosureWheelNode *const node) {
+    assert(self);
+    assert(node);
+    assert(node->pprev);
+    self->counts[node->level]--;
+    *node->pprev = node->next;
+    if (node->next) {
+        node->next->pprev = node->pprev;
+    }
+    node->next = NULL;
+    node->pprev = NULL;
+}
+
+/*
+ * Advances by one tick and returns the list of the timers expired, marked as running and no longer counted in size.
+ * Upper levels are cascaded first, since their timers may land in the slots of the lower levels being cascaded.
+ */
+struct ClosureWheelNode *ClosureWheel_step(struct ClosureWheel *const self) {
+    assert(self);
+    const uint64_t now = ++self->now;
+    size_t levels = 1;
+    while (levels < LEVELS && 0 == (now & (((uint64_t) 1 << (levels * SLOT_BITS)) - 1))) {
+        levels++;
+    }
+    for (size_t level = levels - 1; level > 0; level--) {
+        struct ClosureWheelNode **head = &self->slots[level][(now >> (level * SLOT_BITS)) & SLOT_MASK];
+        struct ClosureWheelNode *node = *head;
+        *head = NULL;
+        while (node) {
+            struct ClosureWheelNode *next = node->next;
+            self->counts[level]--;
+            ClosureWheel_insert(self, node);
+            node = next;
+        }
+    }
+    struct ClosureWheelNode **head = &self->slots[0][now & SLOT_MASK];
+    struct ClosureWheelNode *expired = *head;
+    *head = NULL;
+    for (struct ClosureWheelNode *node = expired; node; node = node->next) {
+        assert(node->expires == now);
+        node->state = ClosureWheelNodeState_Running;
+        node->pprev = NULL;
+        self->counts[0]--;
+        self->size--;
+    }
+    return expired;
+}
+
+/*
+ * Returns the number of ticks that can be skipped without stepping: if the lowest levels are empty, no timer can
+ * expire nor be cascaded before the next slot of the first level that is not.
+ */
+uint64_t ClosureWheel_idle(const struct ClosureWheel *const self) {
+    assert(self);
+    size_t level = 0;
+    while (level + 1 < LEVELS && 0 == self->counts[level]) {
+        level++;
+    }
+    if (0 == level) {
+        return 0;
+    }
+    const uint64_t span = (uint64_t) 1 << (level * SLOT_BITS);
+    return span - 1 - (self->now & (span - 1));
+}
+
+void ClosureWheel_addNanoseconds(struct timespec *const time, const uint64_t nanoseconds) {
+    const uint64_t total = (uint64_t) time->tv_nsec + nanoseconds;
+    time->tv_sec += (time_t) (total / 1000000000u);
+    time->tv_nsec = (long) (total % 1000000000u);
+}
+
+/*
+ * Sleeps until the next tick is due and advances by the ticks elapsed meanwhile, catching up if late.
+ */
+void *ClosureWheel_run(void *const argument) {
+    struct ClosureWheel *self = argument;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    pthread_mutex_lock(&self->mutex);
+    const uint64_t tick = self->tickNanoseconds;
+    while (!self->stopping) {
+        ClosureWheel_addNanoseconds(&deadline, tick);
+        while (!self->stopping && ETIMEDOUT != pthread_cond_timedwait(&self->condition, &self->mutex, &deadline)) {
+        }
+        if (self->stopping) {
+            break;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const int64_t late = (int64_t) (now.tv_sec - deadline.tv_sec) * 1000000000 + (now.tv_nsec - deadline.tv_nsec);
+        const uint64_t ticks = 1 + (late > 0 ? (uint64_t) late / tick : 0);
+        ClosureWheel_addNanoseconds(&deadline, (ticks - 1) * tick);
+        pthread_mutex_unlock(&self->mutex);
+        ClosureWheel_advance(self, ticks);
+        pthread_mutex_lock(&self->mutex);
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return NULL;
+}
@@ -0,0 +1,124 @@
+/*
+Author: daddinuz
+email:  daddinuz@gmail.com
+
+Copyright (c) 2018 Davide Di Carlo
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "closure.h"
+
+#if !(defined(__GNUC__) || defined(__clang__))
+__attribute__(...)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A hierarchical timing wheel calling closures after a delay, once or periodically.
+ * Time is measured in ticks and advanced either explicitly by `ClosureWheel_advance` or by a dedicated thread started
+ * by `ClosureWheel_start`; scheduling and cancelling a timer take constant time regardless of the number of timers.
+ * Every function may be called from any thread, including from the closures being called on expiry.
+ */
+struct ClosureWheel;
+
+/**
+ * A handle to a scheduled timer, it remains safe to use after the timer has expired or has been cancelled.
+ *
+ * @attention this struct must be treated as opaque therefore its members must not be accessed directly.
+ */
+struct ClosureTimer {
+    void *__node;
+    unsigned long __generation;
+};
+
+extern struct ClosureWheel *ClosureWheel_new(void)
+__attribute__((__warn_unused_result__));
+
+/**
+ * Returns the current time of this wheel in ticks, starting from 0.
+ */
+extern uint64_t ClosureWheel_now(struct ClosureWheel *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Returns the number of timers pending.
+ */
+extern size_t ClosureWheel_size(struct ClosureWheel *self)
+__attribute__((__warn_unused_result__, __nonnull__));
+
+/**
+ * Schedules closure to be called by `Closure_call` after delay ticks, at least 1, and then every period ticks if period
+ * is not 0, taking ownership of the given reference.
+ * The results of closure are discarded, therefore it should not return anything that needs to be released.
+ * One-shot timers release closure by `Closure_delete` once called, periodic ones once cancelled.
+ */
+extern struct ClosureTimer
+ClosureWheel_schedule(struct ClosureWheel *self, struct Closure *closure, uint64_t delay, uint64_t period)
+__attribute__((__nonnull__));
+
+/**
+ * Cancels a timer releasing its closure, returns `false` if the timer has already expired or has been cancelled.
+ * A periodic timer may be cancelled while its closure is being called, the closure is then released right after.
+ */
+extern bool ClosureWheel_cancel(struct ClosureWheel *self, struct ClosureTimer timer)
+__attribute__((__nonnull__(1)));
+
+/**
+ * Advances the time of this wheel by ticks, calling the closures of the timers that expire meanwhile in the calling
+ * thread, and returns the number of closures called.
+ */
+extern size_t ClosureWheel_advance(struct ClosureWheel *self, uint64_t ticks)
+__attribute__((__nonnull__));
+
+/**
+ * Starts a thread advancing this wheel by one tick every tickNanoseconds.
+ * Returns false if the thread can't be started or is already running.
+ */
+extern bool ClosureWheel_start(struct ClosureWheel *self, uint64_t tickNanoseconds)
+__attribute__((__nonnull__));
+
+/**
+ * Stops the thread started by `ClosureWheel_start`, if any, waiting for it to terminate.
+ *
+ * @attention must not be called from the closures of this wheel.
+ */
+extern void ClosureWheel_stop(struct ClosureWheel *self)
+__attribute__((__nonnull__));
+
+/**
+ * Stops this wheel and deletes it releasing the closures of the timers pending without calling them.
+ *
+ * @attention must not be called from the closures of this wheel.
+ */
+extern void ClosureWheel_delete(struct ClosureWheel *self);
+
+#ifdef __cplusplus
+}
+#endif